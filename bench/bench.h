@@ -0,0 +1,100 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 设备的 ioctl 定义和测试共用
+#include "../test/test.h"
+
+// 性能测试的公共部分：计时、收集每次操作的耗时、输出结果
+// 每个测试程序输出若干行结果，列固定，方便和之前的结果比较：
+//   bench,case,quantum,size,threads,ops,mb_s,p50_ns,p99_ns,p999_ns
+// 不适用的列为 0。默认输出 CSV（不带表头），加 -j 参数时每行输出一个 JSON 对象
+
+static int bench_json;
+
+static void bench_init(int argc, char *argv[]) {
+    bench_json = argc > 1 && strcmp(argv[1], "-j") == 0;
+}
+
+static inline uint64_t bench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 一组测量结果
+struct bench_result {
+    const char *bench;
+    const char *name;  // 测试用例
+    int quantum;
+    size_t size;  // 每次操作的字节数
+    int threads;
+    uint64_t *ns;  // 每次操作的耗时
+    size_t n, cap;
+    uint64_t bytes;    // 总字节数
+    uint64_t elapsed;  // 总耗时，用来计算吞吐量
+};
+
+static void bench_start(struct bench_result *r, const char *bench,
+                        const char *name, size_t cap) {
+    memset(r, 0, sizeof(*r));
+    r->bench = bench;
+    r->name = name;
+    r->threads = 1;
+    r->cap = cap;
+    r->ns = malloc(cap * sizeof(uint64_t));
+    SCULL_ASSERT(r->ns != NULL);
+}
+
+static inline void bench_sample(struct bench_result *r, uint64_t ns) {
+    if (r->n < r->cap) r->ns[r->n++] = ns;
+}
+
+static int bench_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t bench_percentile(const struct bench_result *r, double p) {
+    size_t i;
+
+    if (!r->n) return 0;
+    i = (size_t)(p * (r->n - 1) + 0.5);
+    return r->ns[i];
+}
+
+// 输出一行结果并释放样本
+static void bench_report(struct bench_result *r) {
+    double mb_s = r->elapsed ? r->bytes * 1e3 / r->elapsed : 0;
+    uint64_t p50, p99, p999;
+
+    qsort(r->ns, r->n, sizeof(uint64_t), bench_cmp);
+    p50 = bench_percentile(r, 0.50);
+    p99 = bench_percentile(r, 0.99);
+    p999 = bench_percentile(r, 0.999);
+    if (bench_json)
+        printf("{\"bench\": \"%s\", \"case\": \"%s\", \"quantum\": %d, "
+               "\"size\": %zu, \"threads\": %d, \"ops\": %zu, "
+               "\"mb_s\": %.1f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+               "\"p999_ns\": %llu}\n",
+               r->bench, r->name, r->quantum, r->size, r->threads, r->n, mb_s,
+               (unsigned long long)p50, (unsigned long long)p99,
+               (unsigned long long)p999);
+    else
+        printf("%s,%s,%d,%zu,%d,%zu,%.1f,%llu,%llu,%llu\n", r->bench, r->name,
+               r->quantum, r->size, r->threads, r->n, mb_s,
+               (unsigned long long)p50, (unsigned long long)p99,
+               (unsigned long long)p999);
+    fflush(stdout);
+    free(r->ns);
+    r->ns = NULL;
+}
+
+#endif
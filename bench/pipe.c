@@ -0,0 +1,133 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+// scullpipe 的往返延迟和流式带宽
+// 往返：父进程往 scullpipe0 写一条消息，子进程读出后原样写到 scullpipe1，父进程读回，记录往返时间
+// 流式：父进程连续写入，子进程连续读出，记录每次写入的耗时和总带宽
+
+#define PING_DEVICE "/dev/scullpipe0"
+#define PONG_DEVICE "/dev/scullpipe1"
+#define ROUNDS 20000
+#define STREAM (64 << 20)  // 流式测试传输的总字节数
+
+static const size_t ping_sizes[] = {1, 64, 512};
+static const size_t stream_sizes[] = {64, 512, 4096};
+
+// 读满 n 个字节
+static void read_full(int fd, char *buf, size_t n) {
+    ssize_t ret;
+
+    while (n) {
+        ret = read(fd, buf, n);
+        SCULL_ASSERT(ret > 0);
+        buf += ret;
+        n -= ret;
+    }
+}
+
+static void write_full(int fd, const char *buf, size_t n) {
+    ssize_t ret;
+
+    while (n) {
+        ret = write(fd, buf, n);
+        SCULL_ASSERT(ret > 0);
+        buf += ret;
+        n -= ret;
+    }
+}
+
+static void ping_pong(int ping, int pong, size_t size, char *buf) {
+    struct bench_result r;
+    uint64_t t0, start;
+    pid_t pid;
+    int i, status;
+
+    pid = fork();
+    SCULL_ASSERT(pid >= 0);
+    if (pid == 0) {
+        for (i = 0; i < ROUNDS; i++) {
+            read_full(ping, buf, size);
+            write_full(pong, buf, size);
+        }
+        exit(0);
+    }
+
+    bench_start(&r, "pipe", "ping_pong", ROUNDS);
+    r.size = size;
+    start = bench_now();
+    for (i = 0; i < ROUNDS; i++) {
+        t0 = bench_now();
+        write_full(ping, buf, size);
+        read_full(pong, buf, size);
+        bench_sample(&r, bench_now() - t0);
+        r.bytes += 2 * size;
+    }
+    r.elapsed = bench_now() - start;
+    waitpid(pid, &status, 0);
+    SCULL_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    bench_report(&r);
+}
+
+static void stream(int fd, size_t size, char *buf) {
+    struct bench_result r;
+    size_t ops = STREAM / size, i;
+    uint64_t t0, start;
+    pid_t pid;
+    int status;
+
+    pid = fork();
+    SCULL_ASSERT(pid >= 0);
+    if (pid == 0) {
+        read_full(fd, buf, ops * size);
+        exit(0);
+    }
+
+    bench_start(&r, "pipe", "stream", ops);
+    r.size = size;
+    start = bench_now();
+    for (i = 0; i < ops; i++) {
+        t0 = bench_now();
+        write_full(fd, buf, size);
+        bench_sample(&r, bench_now() - t0);
+        r.bytes += size;
+    }
+    // 数据全部被读出才算传输完成
+    waitpid(pid, &status, 0);
+    r.elapsed = bench_now() - start;
+    SCULL_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    bench_report(&r);
+}
+
+int main(int argc, char *argv[]) {
+    int ping, pong;
+    size_t i;
+    char *buf;
+
+    bench_init(argc, argv);
+    ping = open(PING_DEVICE, O_RDWR);
+    pong = open(PONG_DEVICE, O_RDWR);
+    if (ping < 0 || pong < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    // 流式测试的子进程一次读完所有数据
+    buf = malloc(STREAM);
+    SCULL_ASSERT(buf != NULL);
+    memset(buf, 'x', STREAM);
+
+    for (i = 0; i < sizeof(ping_sizes) / sizeof(ping_sizes[0]); i++)
+        ping_pong(ping, pong, ping_sizes[i], buf);
+    for (i = 0; i < sizeof(stream_sizes) / sizeof(stream_sizes[0]); i++)
+        stream(ping, stream_sizes[i], buf);
+
+    free(buf);
+    close(ping);
+    close(pong);
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+// scull 的顺序和随机读写吞吐量
+// 量子大小只在创建设备时生效：修改模块的默认量子大小（需要 root）后打开 scullfd 得到新设备。
+// 没有权限时只测试当前的默认量子大小
+
+#define FD_DEVICE "/dev/scullfd"
+#define REGION (16 << 20)  // 每个用例读写的总字节数
+
+static const int quanta[] = {1000, 4000, 16000, 65536};
+static const size_t sizes[] = {64, 512, 4096, 65536};
+
+// 一个用例：依次读写整个区域，随机时每次操作的偏移量是 size 的随机倍数
+static void run_case(int fd, int quantum, size_t size, bool write, bool rnd,
+                     char *buf) {
+    struct bench_result r;
+    size_t ops = REGION / size, i;
+    unsigned int seed = 1;
+    uint64_t t0, t, start;
+    off_t off;
+    ssize_t ret;
+    char name[32];
+
+    snprintf(name, sizeof(name), "%s_%s", rnd ? "rand" : "seq",
+             write ? "write" : "read");
+    bench_start(&r, "rw", name, ops);
+    r.quantum = quantum;
+    r.size = size;
+
+    start = bench_now();
+    for (i = 0; i < ops; i++) {
+        off = (off_t)(rnd ? rand_r(&seed) % ops : i) * size;
+        t0 = bench_now();
+        ret = write ? pwrite(fd, buf, size, off) : pread(fd, buf, size, off);
+        t = bench_now();
+        SCULL_ASSERT(ret > 0);
+        bench_sample(&r, t - t0);
+        r.bytes += ret;
+    }
+    r.elapsed = bench_now() - start;
+    bench_report(&r);
+}
+
+static void run_quantum(char *buf) {
+    int fd, quantum;
+    size_t j;
+
+    fd = open(FD_DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+    quantum = ioctl(fd, SCULL_IOCQQUANTUM);
+    for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+        // 先顺序写一遍，之后的读和随机写都落在已经分配的量子上
+        run_case(fd, quantum, sizes[j], true, false, buf);
+        run_case(fd, quantum, sizes[j], false, false, buf);
+        run_case(fd, quantum, sizes[j], true, true, buf);
+        run_case(fd, quantum, sizes[j], false, true, buf);
+    }
+    close(fd);
+}
+
+int main(int argc, char *argv[]) {
+    int fd, old;
+    size_t i;
+    char *buf;
+
+    bench_init(argc, argv);
+    buf = malloc(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+    SCULL_ASSERT(buf != NULL);
+    memset(buf, 'x', sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+
+    fd = open(FD_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    old = ioctl(fd, SCULL_IOCQQUANTUM);
+    for (i = 0; i < sizeof(quanta) / sizeof(quanta[0]); i++) {
+        if (ioctl(fd, SCULL_IOCTQUANTUM, quanta[i]) < 0) {
+            fprintf(stderr, "rw: can't set quantum, using the default\n");
+            run_quantum(buf);
+            break;
+        }
+        run_quantum(buf);
+    }
+    // 恢复默认的量子大小
+    ioctl(fd, SCULL_IOCTQUANTUM, old);
+    close(fd);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+// 线程数扩展性
+// shared：所有线程读写 scull0 上互不重叠的区域，竞争同一把互斥锁
+// private：每个线程打开 scullfd，各自使用私有设备
+// 每个线程交替写入和读取 SIZE 字节，记录每次操作的耗时
+
+#define FD_DEVICE "/dev/scullfd"
+#define SIZE 4096
+#define OPS 20000         // 每个线程的操作次数
+#define AREA (1 << 20)    // 每个线程读写的区域大小
+#define MAX_THREADS 64
+
+struct worker {
+    pthread_t thread;
+    const char *device;
+    int index;
+    struct bench_result r;
+};
+
+static void *worker_fn(void *arg) {
+    struct worker *w = arg;
+    off_t base = (off_t)w->index * AREA, off;
+    char buf[SIZE];
+    uint64_t t0;
+    ssize_t ret;
+    int fd, i;
+
+    memset(buf, 'x', sizeof(buf));
+    fd = open(w->device, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+    for (i = 0; i < OPS; i++) {
+        off = base + (off_t)(i / 2) * SIZE % AREA;
+        t0 = bench_now();
+        ret = i % 2 ? pread(fd, buf, SIZE, off) : pwrite(fd, buf, SIZE, off);
+        bench_sample(&w->r, bench_now() - t0);
+        SCULL_ASSERT(ret > 0);
+        w->r.bytes += ret;
+    }
+    close(fd);
+    return NULL;
+}
+
+static void run(const char *name, const char *device, int threads) {
+    static struct worker workers[MAX_THREADS];
+    struct bench_result r;
+    uint64_t start;
+    int i;
+
+    for (i = 0; i < threads; i++) {
+        workers[i].device = device;
+        // 私有设备各自从 0 开始
+        workers[i].index = strcmp(device, DEVICE) ? 0 : i;
+        bench_start(&workers[i].r, "scaling", name, OPS);
+    }
+    start = bench_now();
+    for (i = 0; i < threads; i++)
+        SCULL_ASSERT(pthread_create(&workers[i].thread, NULL, worker_fn,
+                                    workers + i) == 0);
+    for (i = 0; i < threads; i++) pthread_join(workers[i].thread, NULL);
+
+    // 合并所有线程的样本
+    bench_start(&r, "scaling", name, (size_t)OPS * threads);
+    r.elapsed = bench_now() - start;
+    r.size = SIZE;
+    r.threads = threads;
+    for (i = 0; i < threads; i++) {
+        memcpy(r.ns + r.n, workers[i].r.ns, workers[i].r.n * sizeof(uint64_t));
+        r.n += workers[i].r.n;
+        r.bytes += workers[i].r.bytes;
+        free(workers[i].r.ns);
+    }
+    bench_report(&r);
+}
+
+int main(int argc, char *argv[]) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads, fd;
+
+    bench_init(argc, argv);
+    fd = open(DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    close(fd);
+
+    // 1、2、4……直到 CPU 数量的 2 倍
+    for (threads = 1; threads <= 2 * ncpu && threads <= MAX_THREADS;
+         threads *= 2) {
+        run("shared", DEVICE, threads);
+        run("private", FD_DEVICE, threads);
+    }
+
+    // 只写打开清空 scull0，不影响其他测试
+    fd = open(DEVICE, O_WRONLY);
+    if (fd >= 0) close(fd);
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+// scullpipe 的唤醒延迟
+// 写者把当前时间写入管道，睡眠中的读者被唤醒后读出这个时间，两者之差就是唤醒延迟。
+// read：读者阻塞在 read 中
+// poll：读者阻塞在 poll 中，返回后再读
+// fasync：读者在 sigwaitinfo 中等待 SIGIO，收到后非阻塞地读
+
+#define ROUNDS 5000
+#define GAP_US 200  // 两次写入之间的间隔，保证读者已经睡眠
+
+enum mode { MODE_READ, MODE_POLL, MODE_FASYNC };
+
+struct reader {
+    int fd;
+    enum mode mode;
+    pid_t tid;
+    volatile int ready;
+    struct bench_result r;
+};
+
+static void *reader_fn(void *arg) {
+    struct reader *rd = arg;
+    struct pollfd pfd = {.fd = rd->fd, .events = POLLIN};
+    uint64_t ts;
+    sigset_t set;
+    siginfo_t si;
+    ssize_t ret;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGIO);
+    rd->tid = syscall(SYS_gettid);
+    __atomic_store_n(&rd->ready, 1, __ATOMIC_RELEASE);
+
+    while (rd->r.n < ROUNDS) {
+        if (rd->mode == MODE_POLL)
+            SCULL_ASSERT(poll(&pfd, 1, -1) == 1);
+        else if (rd->mode == MODE_FASYNC)
+            SCULL_ASSERT(sigwaitinfo(&set, &si) == SIGIO);
+        // fasync 模式下文件是非阻塞的，SIGIO 不排队，收到一次信号就读出所有数据
+        do {
+            ret = read(rd->fd, &ts, sizeof(ts));
+            if (ret == sizeof(ts)) bench_sample(&rd->r, bench_now() - ts);
+        } while (rd->mode == MODE_FASYNC && ret == sizeof(ts));
+        if (ret != sizeof(ts))
+            SCULL_ASSERT(rd->mode == MODE_FASYNC && errno == EAGAIN);
+    }
+    return NULL;
+}
+
+static void run(const char *name, enum mode mode) {
+    struct reader rd = {.mode = mode};
+    struct f_owner_ex owner;
+    pthread_t thread;
+    uint64_t ts;
+    int i, wfd;
+
+    rd.fd = open(PIPE_DEVICE, O_RDONLY | (mode == MODE_FASYNC ? O_NONBLOCK : 0));
+    wfd = open(PIPE_DEVICE, O_WRONLY);
+    SCULL_ASSERT(rd.fd >= 0 && wfd >= 0);
+    bench_start(&rd.r, "wakeup", name, ROUNDS);
+    rd.r.size = sizeof(ts);
+
+    SCULL_ASSERT(pthread_create(&thread, NULL, reader_fn, &rd) == 0);
+    while (!__atomic_load_n(&rd.ready, __ATOMIC_ACQUIRE)) usleep(100);
+    if (mode == MODE_FASYNC) {
+        // SIGIO 只发给读者线程
+        owner.type = F_OWNER_TID;
+        owner.pid = rd.tid;
+        SCULL_ASSERT(fcntl(rd.fd, F_SETOWN_EX, &owner) == 0);
+        SCULL_ASSERT(fcntl(rd.fd, F_SETFL, fcntl(rd.fd, F_GETFL) | O_ASYNC) ==
+                     0);
+    }
+
+    rd.r.elapsed = bench_now();
+    for (i = 0; i < ROUNDS; i++) {
+        usleep(GAP_US);
+        ts = bench_now();
+        SCULL_ASSERT(write(wfd, &ts, sizeof(ts)) == sizeof(ts));
+    }
+    pthread_join(thread, NULL);
+    rd.r.elapsed = bench_now() - rd.r.elapsed;
+    rd.r.bytes = (uint64_t)ROUNDS * sizeof(ts);
+    close(wfd);
+    close(rd.fd);
+    bench_report(&rd.r);
+}
+
+int main(int argc, char *argv[]) {
+    sigset_t set;
+    int fd;
+
+    bench_init(argc, argv);
+    fd = open(PIPE_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    close(fd);
+
+    // 所有线程都屏蔽 SIGIO，读者线程通过 sigwaitinfo 同步接收
+    sigemptyset(&set);
+    sigaddset(&set, SIGIO);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    run("read", MODE_READ);
+    run("poll", MODE_POLL);
+    run("fasync", MODE_FASYNC);
+    return 0;
+}
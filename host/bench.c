@@ -0,0 +1,326 @@
+#include <pthread.h>
+#include <time.h>
+
+#include "scull_host.h"
+
+// scull 核心代码在用户空间的微基准测试
+// 不经过系统调用，直接测量量子定位、读写、释放和管道环形缓冲区本身的开销，
+// 可以配合 perf record、valgrind --tool=callgrind 等工具分析。
+// 输出的列和 bench/ 下的测试相同：
+//   bench,case,quantum,size,threads,ops,mb_s,p50_ns,p99_ns,p999_ns
+// -j 输出 JSON，-q 缩小规模，只做快速检查
+
+static bool json, quick;
+
+struct result {
+    const char *name;
+    int quantum;
+    size_t size;
+    int threads;
+    u64 *ns;
+    size_t n, cap;
+    u64 bytes, elapsed;
+};
+
+static void start(struct result *r, const char *name, size_t cap) {
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->threads = 1;
+    r->cap = cap;
+    r->ns = malloc(cap * sizeof(u64));
+    if (!r->ns) abort();
+}
+
+static inline void sample(struct result *r, u64 ns) {
+    if (r->n < r->cap) r->ns[r->n++] = ns;
+}
+
+static int cmp(const void *a, const void *b) {
+    u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static u64 percentile(const struct result *r, double p) {
+    return r->n ? r->ns[(size_t)(p * (r->n - 1) + 0.5)] : 0;
+}
+
+static void report(struct result *r) {
+    double mb_s = r->elapsed ? r->bytes * 1e3 / r->elapsed : 0;
+
+    qsort(r->ns, r->n, sizeof(u64), cmp);
+    if (json)
+        printf("{\"bench\": \"host\", \"case\": \"%s\", \"quantum\": %d, "
+               "\"size\": %zu, \"threads\": %d, \"ops\": %zu, "
+               "\"mb_s\": %.1f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+               "\"p999_ns\": %llu}\n",
+               r->name, r->quantum, r->size, r->threads, r->n, mb_s,
+               percentile(r, 0.5), percentile(r, 0.99), percentile(r, 0.999));
+    else
+        printf("host,%s,%d,%zu,%d,%zu,%.1f,%llu,%llu,%llu\n", r->name,
+               r->quantum, r->size, r->threads, r->n, mb_s,
+               percentile(r, 0.5), percentile(r, 0.99), percentile(r, 0.999));
+    fflush(stdout);
+    free(r->ns);
+}
+
+// 用指定的量子参数加载“模块”
+static void load(int quantum, int qset) {
+    scull_quantum = quantum;
+    scull_qset = qset;
+    if (scull_host_init()) {
+        fprintf(stderr, "scull_host_init failed\n");
+        exit(1);
+    }
+}
+
+static struct file *open_or_die(dev_t devno, unsigned int flags) {
+    struct file *filp = scull_host_open(devno, flags);
+
+    if (IS_ERR(filp)) {
+        fprintf(stderr, "open: %ld\n", PTR_ERR(filp));
+        exit(1);
+    }
+    return filp;
+}
+
+// 量子集合链表的定位：顺序访问可以从上一次的位置继续，随机访问平均要走半个链表。
+// 单次定位只有几纳秒，每 64 次计一次时
+#define FOLLOW_BATCH 64
+
+static void bench_follow(void) {
+    int nq = quick ? 256 : 4096, rounds = quick ? 4 : 16, i, j, k;
+    struct scull_dev *dev;
+    struct result r;
+    struct file *filp;
+    unsigned int seed = 1;
+    u64 t0, begin;
+    char c = 1;
+
+    // 量子集合很小，链表很长
+    load(64, 4);
+    filp = open_or_die(scull_host_dev(0), O_RDWR);
+    dev = filp->private_data;
+    for (i = 0; i < nq; i++) scull_host_pwrite(filp, &c, 1, (loff_t)i * 256);
+
+    for (k = 0; k < 2; k++) {
+        start(&r, k ? "follow_rand" : "follow_seq", rounds * nq / FOLLOW_BATCH);
+        r.quantum = 64;
+        down(&dev->sem);
+        begin = local_clock();
+        for (j = 0; j < rounds * nq; j += FOLLOW_BATCH) {
+            t0 = local_clock();
+            for (i = 0; i < FOLLOW_BATCH; i++)
+                scull_follow(dev, k ? rand_r(&seed) % nq : (j + i) % nq);
+            sample(&r, (local_clock() - t0) / FOLLOW_BATCH);
+        }
+        r.elapsed = local_clock() - begin;
+        up(&dev->sem);
+        report(&r);
+    }
+    scull_host_close(filp);
+    scull_host_exit();
+}
+
+// 顺序读写和释放，覆盖不同的量子大小和请求大小
+static const int quanta[] = {1000, 4000, 16000, 65536};
+static const size_t sizes[] = {64, 4096, 65536};
+
+static void bench_rw_case(struct file *filp, int quantum, size_t size,
+                          bool write, char *buf, size_t region) {
+    struct result r;
+    size_t ops = region / size, i;
+    loff_t off = 0;
+    ssize_t ret;
+    u64 t0, begin;
+
+    start(&r, write ? "seq_write" : "seq_read", ops * 2);
+    r.quantum = quantum;
+    r.size = size;
+    begin = local_clock();
+    for (i = 0; i < ops; i++) {
+        t0 = local_clock();
+        ret = write ? scull_host_pwrite(filp, buf, size, off)
+                    : scull_host_pread(filp, buf, size, off);
+        sample(&r, local_clock() - t0);
+        if (ret <= 0) {
+            fprintf(stderr, "%s: %zd\n", r.name, ret);
+            exit(1);
+        }
+        off += ret;
+        r.bytes += ret;
+    }
+    r.elapsed = local_clock() - begin;
+    report(&r);
+}
+
+static void bench_rw(void) {
+    size_t region = quick ? 1 << 20 : 16 << 20, q, s;
+    struct file *filp;
+    char *buf = malloc(65536);
+
+    memset(buf, 0x5a, 65536);
+    for (q = 0; q < ARRAY_SIZE(quanta); q++) {
+        load(quanta[q], SCULL_QSET);
+        for (s = 0; s < ARRAY_SIZE(sizes); s++) {
+            // 只写打开会清空设备，每个用例都从空设备开始写
+            filp = open_or_die(scull_host_dev(0), O_WRONLY);
+            bench_rw_case(filp, quanta[q], sizes[s], true, buf, region);
+            scull_host_close(filp);
+            filp = open_or_die(scull_host_dev(0), O_RDONLY);
+            bench_rw_case(filp, quanta[q], sizes[s], false, buf, region);
+            scull_host_close(filp);
+        }
+        scull_host_exit();
+    }
+    free(buf);
+}
+
+// 释放整个设备的开销，和量子数量成正比
+static void bench_trim(void) {
+    size_t region = quick ? 1 << 20 : 16 << 20, q;
+    int reps = quick ? 4 : 20, i;
+    struct scull_dev *dev;
+    struct file *filp;
+    struct result r;
+    loff_t off;
+    u64 t0;
+    char *buf = malloc(65536);
+
+    memset(buf, 0x5a, 65536);
+    for (q = 0; q < ARRAY_SIZE(quanta); q++) {
+        load(quanta[q], SCULL_QSET);
+        filp = open_or_die(scull_host_dev(0), O_RDWR);
+        dev = filp->private_data;
+        start(&r, "trim", reps);
+        r.quantum = quanta[q];
+        r.size = region;
+        for (i = 0; i < reps; i++) {
+            for (off = 0; off < region;)
+                off += scull_host_pwrite(filp, buf, 65536, off);
+            down(&dev->sem);
+            t0 = local_clock();
+            scull_trim(dev);
+            sample(&r, local_clock() - t0);
+            r.elapsed += r.ns[r.n - 1];
+            up(&dev->sem);
+            r.bytes += region;
+        }
+        report(&r);
+        scull_host_close(filp);
+        scull_host_exit();
+    }
+    free(buf);
+}
+
+// 管道：单线程交替写入和读取，块大小不整除缓冲区大小，读写指针不断绕回
+static void bench_pipe_wrap(void) {
+    static const size_t chunks[] = {1, 100, 1000, 3000};
+    size_t ops = quick ? 20000 : 500000, i, c;
+    struct file *w, *rd;
+    struct result r;
+    char buf[4096];
+    u64 t0, begin;
+    ssize_t ret;
+
+    load(SCULL_QUANTUM, SCULL_QSET);
+    for (c = 0; c < ARRAY_SIZE(chunks); c++) {
+        rd = open_or_die(scull_host_pipe(0), O_RDONLY | O_NONBLOCK);
+        w = open_or_die(scull_host_pipe(0), O_WRONLY | O_NONBLOCK);
+        start(&r, "pipe_wrap", ops);
+        r.size = chunks[c];
+        begin = local_clock();
+        for (i = 0; i < ops; i++) {
+            t0 = local_clock();
+            ret = scull_host_write(w, buf, chunks[c]);
+            if (ret > 0) ret = scull_host_read(rd, buf, ret);
+            sample(&r, local_clock() - t0);
+            if (ret <= 0) {
+                fprintf(stderr, "pipe_wrap: %zd\n", ret);
+                exit(1);
+            }
+            r.bytes += ret;
+        }
+        r.elapsed = local_clock() - begin;
+        report(&r);
+        scull_host_close(w);
+        scull_host_close(rd);
+    }
+    scull_host_exit();
+}
+
+// 管道：一个写线程和一个读线程阻塞读写，测量等待队列的睡眠和唤醒
+struct pipe_arg {
+    struct file *filp;
+    size_t size, total;
+};
+
+static void *pipe_writer(void *data) {
+    struct pipe_arg *a = data;
+    char buf[4096] = {0};
+    size_t done = 0;
+    ssize_t ret;
+
+    while (done < a->total) {
+        ret = scull_host_write(a->filp, buf, min(a->size, a->total - done));
+        if (ret <= 0) break;
+        done += ret;
+    }
+    return NULL;
+}
+
+static void bench_pipe_threads(void) {
+    static const size_t sizes[] = {64, 1024, 4096};
+    size_t total = quick ? 4 << 20 : 64 << 20, s;
+    struct pipe_arg a;
+    struct result r;
+    pthread_t tid;
+    struct file *rd;
+    char buf[4096];
+    u64 t0, begin;
+    ssize_t ret;
+
+    load(SCULL_QUANTUM, SCULL_QSET);
+    for (s = 0; s < ARRAY_SIZE(sizes); s++) {
+        rd = open_or_die(scull_host_pipe(0), O_RDONLY);
+        a.filp = open_or_die(scull_host_pipe(0), O_WRONLY);
+        a.size = sizes[s];
+        a.total = total;
+        start(&r, "pipe_threads", total / sizes[s] + 1);
+        r.size = sizes[s];
+        r.threads = 2;
+        begin = local_clock();
+        pthread_create(&tid, NULL, pipe_writer, &a);
+        while (r.bytes < total) {
+            t0 = local_clock();
+            ret = scull_host_read(rd, buf, sizes[s]);
+            sample(&r, local_clock() - t0);
+            if (ret <= 0) break;
+            r.bytes += ret;
+        }
+        r.elapsed = local_clock() - begin;
+        pthread_join(tid, NULL);
+        report(&r);
+        scull_host_close(a.filp);
+        scull_host_close(rd);
+    }
+    scull_host_exit();
+}
+
+int main(int argc, char *argv[]) {
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0)
+            json = true;
+        else if (strcmp(argv[i], "-q") == 0)
+            quick = true;
+    }
+    kshim_quiet = true;
+    bench_follow();
+    bench_rw();
+    bench_trim();
+    bench_pipe_wrap();
+    bench_pipe_threads();
+    return 0;
+}
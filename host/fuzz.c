@@ -0,0 +1,292 @@
+#include <time.h>
+#include <unistd.h>
+
+#include "scull_host.h"
+
+// scull 核心代码的模糊测试
+// 输入的前 3 个字节选择量子大小、量子集合长度和管道缓冲区大小（都取得很小，让操作频繁跨越边界），
+// 之后每个操作占 4 个字节：操作码和 3 个参数。
+// scull 设备和一个平坦的字节数组比较，管道和一个记录读写位置的环形缓冲区模型比较，
+// 每个操作之后检查返回值，读到的内容和模型逐字节比较，不一致时 abort。
+// 可以打开分配失败注入，检查内存不足时的错误路径不会破坏数据结构。
+// 配合 SANITIZE=1 同时检查越界访问、释放后使用和内存泄漏。
+// FUZZER=1（clang）时由 libFuzzer 驱动，否则用自带的 main 生成随机输入或者重放文件：
+//   fuzz [-n 次数] [-s 种子] [文件...]
+
+#define MAX_OFF 4096
+#define MAX_LEN 256
+
+struct model {
+    unsigned char data[MAX_OFF + MAX_LEN];
+    size_t size;
+    unsigned long limit;
+    // 管道的模型，位置和驱动的读写指针一一对应
+    unsigned char ring[256];
+    int bufsize, rpos, wpos;
+};
+
+#define CHECK(expr)                                                      \
+    do {                                                                 \
+        if (!(expr)) {                                                   \
+            fprintf(stderr, "fuzz: %s:%d: check failed: %s\n", __FILE__, \
+                    __LINE__, #expr);                                    \
+            abort();                                                     \
+        }                                                                \
+    } while (0)
+
+static int ring_used(const struct model *m) {
+    return (m->wpos - m->rpos + m->bufsize) % m->bufsize;
+}
+
+// 非阻塞写入能写多少：不超过剩余空间，一次最多写到缓冲区末尾（和 scull_p_do_write 一致）
+static int ring_writable(const struct model *m) {
+    int free = m->bufsize - 1 - ring_used(m);
+
+    if (m->wpos >= m->rpos) return min(free, m->bufsize - m->wpos);
+    return free;
+}
+
+static void fill(unsigned char *buf, size_t len, unsigned char seed) {
+    size_t i;
+
+    // 最低位为 0 时写入全零，覆盖全零量子变成空洞的路径
+    for (i = 0; i < len; i++) buf[i] = seed & 1 ? seed + i * 7 : 0;
+}
+
+static void scull_check_write(struct file *filp, struct model *m, loff_t off,
+                              size_t len, unsigned char seed) {
+    unsigned char buf[MAX_LEN];
+    int quantum = ((struct scull_dev *)filp->private_data)->quantum;
+    size_t expect = min(len, (size_t)(quantum - off % quantum));
+    ssize_t ret;
+    bool armed = kshim_fail_nth;
+
+    fill(buf, len, seed);
+    ret = scull_host_pwrite(filp, buf, len, off);
+    if (ret < 0) {
+        // 只有内存上限和注入的分配失败会让写入失败
+        CHECK((ret == -ENOSPC && m->limit) ||
+              (ret == -ENOMEM && armed && !kshim_fail_nth));
+        return;
+    }
+    CHECK((size_t)ret == expect);
+    memcpy(m->data + off, buf, ret);
+    m->size = max(m->size, (size_t)off + ret);
+}
+
+static void scull_check_read(struct file *filp, struct model *m, loff_t off,
+                             size_t len) {
+    unsigned char buf[MAX_LEN];
+    int quantum = ((struct scull_dev *)filp->private_data)->quantum;
+    size_t expect = 0;
+    ssize_t ret;
+    bool armed = kshim_fail_nth;
+
+    if ((size_t)off < m->size)
+        expect = min3(len, (size_t)(quantum - off % quantum), m->size - off);
+    ret = scull_host_pread(filp, buf, len, off);
+    // 读取时定位量子集合也可能分配内存，失败时返回 0
+    if (ret == 0 && armed && !kshim_fail_nth) return;
+    CHECK(ret == (ssize_t)expect);
+    CHECK(!memcmp(buf, m->data + off, ret));
+}
+
+// 整个设备的内容和模型一致
+static void scull_check_all(struct file *filp, struct model *m) {
+    unsigned char buf[MAX_LEN];
+    size_t off = 0;
+    ssize_t ret;
+
+    CHECK(scull_host_lseek(filp, 0, SEEK_END) == (loff_t)m->size);
+    while (off < m->size) {
+        ret = scull_host_pread(filp, buf, sizeof(buf), off);
+        CHECK(ret > 0);
+        CHECK(!memcmp(buf, m->data + off, ret));
+        off += ret;
+    }
+    CHECK(scull_host_pread(filp, buf, sizeof(buf), off) == 0);
+}
+
+static void pipe_check_write(struct file *w, struct model *m, size_t len,
+                             unsigned char seed) {
+    unsigned char buf[2 * 256];
+    ssize_t ret, expect = ring_writable(m);
+    bool armed = kshim_fail_nth;
+    size_t i;
+
+    fill(buf, len, seed | 1);
+    ret = scull_host_write(w, buf, len);
+    if (!expect) {
+        CHECK(ret == -EAGAIN);
+        return;
+    }
+    // 缓冲区被回收后重新分配可能失败
+    if (ret == -ENOMEM && armed && !kshim_fail_nth) return;
+    CHECK(ret == min((ssize_t)len, expect));
+    for (i = 0; i < (size_t)ret; i++) {
+        m->ring[m->wpos] = buf[i];
+        m->wpos = (m->wpos + 1) % m->bufsize;
+    }
+}
+
+static void pipe_check_read(struct file *rd, struct model *m, size_t len) {
+    unsigned char buf[2 * 256];
+    ssize_t ret, expect = min((ssize_t)len, (ssize_t)ring_used(m));
+    size_t i;
+
+    ret = scull_host_read(rd, buf, len);
+    if (!ring_used(m)) {
+        CHECK(ret == -EAGAIN);
+        return;
+    }
+    CHECK(ret == expect);
+    for (i = 0; i < (size_t)ret; i++) {
+        CHECK(buf[i] == m->ring[m->rpos]);
+        m->rpos = (m->rpos + 1) % m->bufsize;
+    }
+}
+
+static void pipe_check_state(struct file *rd, struct model *m) {
+    unsigned int mask = scull_host_poll(rd);
+    int n = -1;
+
+    CHECK(scull_host_ioctl(rd, FIONREAD, (unsigned long)&n) == 0);
+    CHECK(n == ring_used(m));
+    CHECK(!!(mask & EPOLLIN) == (ring_used(m) > 0));
+}
+
+// 内存回收可能释放空的管道缓冲区，之后重新分配时读写位置回到起点
+static void pipe_sync_reclaim(struct file *rd, struct model *m) {
+    struct scull_pipe *dev = ((struct scull_p_file *)rd->private_data)->dev;
+
+    if (!dev->buffer) {
+        CHECK(!ring_used(m));
+        m->rpos = m->wpos = 0;
+    }
+}
+
+static void run(const unsigned char *data, size_t size) {
+    struct file *filp, *rd, *w, *t;
+    struct model *m;
+    const unsigned char *op;
+    loff_t off;
+    size_t len;
+
+    if (size < 3) return;
+    m = calloc(1, sizeof(*m));
+    CHECK(m);
+    scull_quantum = 1 + data[0] % 32;
+    scull_qset = 1 + data[1] % 8;
+    scull_p_buffer = m->bufsize = 2 + data[2] % 128;
+    CHECK(scull_host_init() == 0);
+
+    filp = scull_host_open(scull_host_dev(0), O_RDWR);
+    rd = scull_host_open(scull_host_pipe(0), O_RDONLY | O_NONBLOCK);
+    w = scull_host_open(scull_host_pipe(0), O_WRONLY | O_NONBLOCK);
+    CHECK(!IS_ERR(filp) && !IS_ERR(rd) && !IS_ERR(w));
+
+    for (op = data + 3; op + 4 <= data + size; op += 4) {
+        off = (op[1] << 8 | op[2]) % MAX_OFF;
+        len = 1 + op[3] % MAX_LEN;
+        switch (op[0] % 10) {
+            case 0:
+            case 1:
+                scull_check_write(filp, m, off, len, op[1]);
+                break;
+            case 2:
+            case 3:
+                scull_check_read(filp, m, off, len);
+                break;
+            case 4:
+                // 只写打开清空设备
+                t = scull_host_open(scull_host_dev(0), O_WRONLY);
+                CHECK(!IS_ERR(t));
+                scull_host_close(t);
+                memset(m->data, 0, sizeof(m->data));
+                m->size = 0;
+                break;
+            case 5:
+                // 内存上限为若干个量子，0 表示不限制
+                m->limit = (op[1] % 8) * scull_quantum;
+                CHECK(scull_host_ioctl(filp, SCULL_IOCTLIMIT, m->limit) == 0);
+                break;
+            case 6:
+                // 之后的第 n 次分配失败
+                kshim_fail_nth = 1 + op[1] % 4;
+                break;
+            case 7:
+                pipe_check_write(w, m, 1 + op[3] % (2 * m->bufsize), op[1]);
+                break;
+            case 8:
+                pipe_check_read(rd, m, 1 + op[3] % (2 * m->bufsize));
+                break;
+            case 9:
+                kshim_shrink(op[1]);
+                pipe_sync_reclaim(rd, m);
+                break;
+        }
+        pipe_check_state(rd, m);
+    }
+
+    kshim_fail_nth = 0;
+    scull_check_all(filp, m);
+    scull_host_close(w);
+    scull_host_close(rd);
+    scull_host_close(filp);
+    scull_host_exit();
+    free(m);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    kshim_quiet = true;
+    run(data, size);
+    return 0;
+}
+
+#ifndef SCULL_LIBFUZZER
+static void replay(const char *path) {
+    static unsigned char buf[1 << 16];
+    FILE *f = fopen(path, "rb");
+    size_t n;
+
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(buf, n);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int seed = time(NULL), iters = 10000, i, j, n;
+    unsigned char buf[4 * 256 + 3];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        if (opt == 'n')
+            iters = strtoul(optarg, NULL, 0);
+        else if (opt == 's')
+            seed = strtoul(optarg, NULL, 0);
+        else {
+            fprintf(stderr, "usage: %s [-n iters] [-s seed] [file...]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (optind < argc) {
+        for (; optind < argc; optind++) replay(argv[optind]);
+        return 0;
+    }
+
+    printf("fuzz: seed %u, %u iterations\n", seed, iters);
+    srand(seed);
+    for (i = 0; i < iters; i++) {
+        n = 3 + rand() % (sizeof(buf) - 3);
+        for (j = 0; j < n; j++) buf[j] = rand();
+        LLVMFuzzerTestOneInput(buf, n);
+    }
+    printf("fuzz: ok\n");
+    return 0;
+}
+#endif
@@ -0,0 +1,102 @@
+#include "scull_host.h"
+
+// 用户空间的“VFS”：为每次打开构造 inode 和 file，按文件操作表调用驱动
+
+int scull_host_init(void) { return kshim_module_init(); }
+
+void scull_host_exit(void) { kshim_module_exit(); }
+
+extern int scull_major, scull_minor;
+
+dev_t scull_host_dev(int i) { return MKDEV(scull_major, scull_minor + i); }
+
+dev_t scull_host_pipe(int i) {
+    return MKDEV(scull_major, scull_minor + scull_nr_devs + i);
+}
+
+// 打开的文件和它的 inode 一起分配
+struct scull_host_file {
+    struct file file;
+    struct inode inode;
+};
+
+struct file *scull_host_open(dev_t devno, unsigned int flags) {
+    struct cdev *cdev = kshim_cdev_lookup(devno);
+    struct scull_host_file *hf;
+    int err;
+
+    if (!cdev) return ERR_PTR(-ENXIO);
+    hf = calloc(1, sizeof(*hf));
+    if (!hf) return ERR_PTR(-ENOMEM);
+    hf->inode.i_cdev = cdev;
+    hf->inode.i_rdev = devno;
+    hf->file.f_inode = &hf->inode;
+    hf->file.f_op = cdev->ops;
+    hf->file.f_flags = flags;
+    // 和 VFS 一样由访问模式得到 f_mode
+    if ((flags & O_ACCMODE) != O_WRONLY) hf->file.f_mode |= FMODE_READ;
+    if ((flags & O_ACCMODE) != O_RDONLY) hf->file.f_mode |= FMODE_WRITE;
+
+    err = hf->file.f_op->open ? hf->file.f_op->open(&hf->inode, &hf->file) : 0;
+    if (err) {
+        free(hf);
+        return ERR_PTR(err);
+    }
+    return &hf->file;
+}
+
+int scull_host_close(struct file *filp) {
+    struct scull_host_file *hf = container_of(filp, struct scull_host_file, file);
+    int err = 0;
+
+    if (filp->f_op->release) err = filp->f_op->release(&hf->inode, filp);
+    free(hf);
+    return err;
+}
+
+static ssize_t scull_host_rw(struct file *filp, void *buf, size_t count,
+                             loff_t *ppos, bool write) {
+    struct kiocb kiocb = {.ki_filp = filp, .ki_pos = *ppos};
+    struct iovec iov = {.iov_base = buf, .iov_len = count};
+    struct iov_iter iter;
+    ssize_t ret;
+
+    if (!(filp->f_mode & (write ? FMODE_WRITE : FMODE_READ))) return -EBADF;
+    iov_iter_init(&iter, write ? WRITE : READ, &iov, 1, count);
+    ret = write ? filp->f_op->write_iter(&kiocb, &iter)
+                : filp->f_op->read_iter(&kiocb, &iter);
+    *ppos = kiocb.ki_pos;
+    return ret;
+}
+
+ssize_t scull_host_read(struct file *filp, void *buf, size_t count) {
+    return scull_host_rw(filp, buf, count, &filp->f_pos, false);
+}
+
+ssize_t scull_host_write(struct file *filp, const void *buf, size_t count) {
+    return scull_host_rw(filp, (void *)buf, count, &filp->f_pos, true);
+}
+
+ssize_t scull_host_pread(struct file *filp, void *buf, size_t count,
+                         loff_t pos) {
+    return scull_host_rw(filp, buf, count, &pos, false);
+}
+
+ssize_t scull_host_pwrite(struct file *filp, const void *buf, size_t count,
+                          loff_t pos) {
+    return scull_host_rw(filp, (void *)buf, count, &pos, true);
+}
+
+loff_t scull_host_lseek(struct file *filp, loff_t off, int whence) {
+    if (!filp->f_op->llseek) return -ESPIPE;
+    return filp->f_op->llseek(filp, off, whence);
+}
+
+long scull_host_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
+    if (!filp->f_op->unlocked_ioctl) return -ENOTTY;
+    return filp->f_op->unlocked_ioctl(filp, cmd, arg);
+}
+
+unsigned int scull_host_poll(struct file *filp) {
+    return filp->f_op->poll ? filp->f_op->poll(filp, NULL) : 0;
+}
@@ -0,0 +1,753 @@
+#ifndef KSHIM_H
+#define KSHIM_H
+
+// 内核接口的用户空间替身
+// 只实现 src/main.c、src/pipe.c 和 src/stats.c 用到的部分，语义尽量和内核一致：
+// 内存分配是 malloc，信号量、等待队列和进程睡眠唤醒用 pthread 实现，
+// “用户空间”指针就是普通指针，per-CPU 变量只有一份。
+// include/linux 下的头文件都只是包含这个文件，源文件不需要任何修改就可以编译
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <asm/types.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// 基本类型
+
+// 和内核一样，64 位类型是 long long，__u64 等来自系统的 asm/types.h
+typedef __u8 u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+typedef __s32 s32;
+typedef __s64 s64;
+typedef unsigned int fmode_t;
+typedef unsigned int gfp_t;
+typedef unsigned int __poll_t;
+
+#define __user
+#define __percpu
+#define __force
+#define __init
+#define __exit
+#define __must_check
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+#define READ_ONCE(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WRITE_ONCE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define smp_load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+typedef struct {
+    int counter;
+} atomic_t;
+
+#define atomic_read(v) __atomic_load_n(&(v)->counter, __ATOMIC_SEQ_CST)
+#define atomic_inc(v) \
+    ((void)__atomic_fetch_add(&(v)->counter, 1, __ATOMIC_SEQ_CST))
+#define atomic_dec(v) \
+    ((void)__atomic_fetch_sub(&(v)->counter, 1, __ATOMIC_SEQ_CST))
+
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define BITS_TO_LONGS(n) DIV_ROUND_UP(n, BITS_PER_LONG)
+
+#define min(a, b)              \
+    ({                         \
+        __typeof__(a) _a = (a); \
+        __typeof__(b) _b = (b); \
+        _a < _b ? _a : _b;     \
+    })
+#define max(a, b)              \
+    ({                         \
+        __typeof__(a) _a = (a); \
+        __typeof__(b) _b = (b); \
+        _a > _b ? _a : _b;     \
+    })
+#define min_t(type, a, b) min((type)(a), (type)(b))
+#define max_t(type, a, b) max((type)(a), (type)(b))
+#define min3(a, b, c) min(min(a, b), c)
+#define clamp(v, lo, hi) min(max(v, lo), hi)
+#define swap(a, b)              \
+    do {                        \
+        __typeof__(a) _t = (a); \
+        (a) = (b);              \
+        (b) = _t;               \
+    } while (0)
+
+#define PAGE_SIZE 4096UL
+#define NSEC_PER_USEC 1000UL
+#define NSEC_PER_MSEC 1000000UL
+#define MAX_SCHEDULE_TIMEOUT LONG_MAX
+
+// 内核专用的错误码
+#define ERESTARTSYS 512
+#define ENOTSUPP 524
+
+// 输出
+
+#define KERN_EMERG "<0>"
+#define KERN_ALERT "<1>"
+#define KERN_ERR "<3>"
+#define KERN_WARNING "<4>"
+#define KERN_NOTICE "<5>"
+#define KERN_INFO "<6>"
+#define KERN_DEBUG "<7>"
+
+// 关掉 printk 可以让基准测试和模糊测试的输出保持干净
+extern bool kshim_quiet;
+#define printk(fmt, ...) \
+    ((void)(kshim_quiet || fprintf(stderr, fmt, ##__VA_ARGS__)))
+#define pr_warn(fmt, ...) printk(KERN_WARNING fmt, ##__VA_ARGS__)
+#define pr_warn_ratelimited pr_warn
+
+// 和内核的 memchr_inv 相同：返回第一个不等于 c 的字节，全部相等时返回 NULL
+static inline void *memchr_inv(const void *start, int c, size_t bytes) {
+    const unsigned char *p = start;
+
+    for (; bytes; p++, bytes--)
+        if (*p != (unsigned char)c) return (void *)p;
+    return NULL;
+}
+
+// 错误指针
+
+#define MAX_ERRNO 4095
+static inline void *ERR_PTR(long error) { return (void *)error; }
+static inline long PTR_ERR(const void *ptr) { return (long)ptr; }
+static inline bool IS_ERR(const void *ptr) {
+    return (unsigned long)ptr >= (unsigned long)-MAX_ERRNO;
+}
+static inline bool IS_ERR_OR_NULL(const void *ptr) {
+    return !ptr || IS_ERR(ptr);
+}
+
+// 双向链表
+
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+struct hlist_node {
+    struct hlist_node *next, **pprev;
+};
+
+#define LIST_HEAD_INIT(name) {&(name), &(name)}
+#define LIST_HEAD(name) struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list) {
+    list->next = list->prev = list;
+}
+
+static inline void __list_add(struct list_head *entry, struct list_head *prev,
+                              struct list_head *next) {
+    next->prev = entry;
+    entry->next = next;
+    entry->prev = prev;
+    prev->next = entry;
+}
+
+static inline void list_add(struct list_head *entry, struct list_head *head) {
+    __list_add(entry, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *entry,
+                                 struct list_head *head) {
+    __list_add(entry, head->prev, head);
+}
+
+static inline void __list_del_entry(struct list_head *entry) {
+    entry->next->prev = entry->prev;
+    entry->prev->next = entry->next;
+}
+
+static inline void list_del(struct list_head *entry) {
+    __list_del_entry(entry);
+    entry->next = entry->prev = NULL;
+}
+
+static inline void list_del_init(struct list_head *entry) {
+    __list_del_entry(entry);
+    INIT_LIST_HEAD(entry);
+}
+
+static inline void list_move_tail(struct list_head *entry,
+                                  struct list_head *head) {
+    __list_del_entry(entry);
+    list_add_tail(entry, head);
+}
+
+static inline bool list_empty(const struct list_head *head) {
+    return head->next == head;
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) \
+    list_entry((ptr)->next, type, member)
+#define list_next_entry(pos, member) \
+    list_entry((pos)->member.next, __typeof__(*(pos)), member)
+#define list_for_each_entry(pos, head, member)                     \
+    for (pos = list_entry((head)->next, __typeof__(*pos), member); \
+         &pos->member != (head); pos = list_next_entry(pos, member))
+#define list_for_each_entry_safe(pos, n, head, member)              \
+    for (pos = list_entry((head)->next, __typeof__(*pos), member),  \
+        n = list_next_entry(pos, member);                           \
+         &pos->member != (head); pos = n, n = list_next_entry(n, member))
+
+// 内存分配
+// kshim_fail_nth 不为 0 时，从现在开始的第 n 次分配失败，用来在模糊测试中覆盖内存不足的路径
+
+#define GFP_KERNEL 0x1u
+#define GFP_KERNEL_ACCOUNT 0x3u
+#define GFP_ATOMIC 0x4u
+
+extern unsigned long kshim_fail_nth;
+
+void *kmalloc(size_t size, gfp_t flags);
+void *kzalloc(size_t size, gfp_t flags);
+void *kcalloc(size_t n, size_t size, gfp_t flags);
+void *kmalloc_array(size_t n, size_t size, gfp_t flags);
+void kfree(const void *p);
+size_t ksize(const void *p);
+#define kvmalloc kmalloc
+#define kvzalloc kzalloc
+#define kvmalloc_array kmalloc_array
+#define kvfree kfree
+
+// per-CPU 变量：只有一个 CPU，更新使用原子操作，多线程的基准测试也能得到正确的计数
+
+#define alloc_percpu(type) ((type *)kzalloc(sizeof(type), GFP_KERNEL))
+#define free_percpu(p) kfree(p)
+#define per_cpu_ptr(p, cpu) ((void)(cpu), (p))
+#define for_each_possible_cpu(cpu) for ((cpu) = 0; (cpu) < 1; (cpu)++)
+#define this_cpu_add(x, v) \
+    ((void)__atomic_fetch_add(&(x), (v), __ATOMIC_RELAXED))
+#define this_cpu_inc(x) this_cpu_add(x, 1)
+
+// 静态键：普通的布尔变量
+
+struct static_key_true {
+    bool enabled;
+};
+#define DECLARE_STATIC_KEY_TRUE(name) extern struct static_key_true name
+#define DEFINE_STATIC_KEY_TRUE(name) struct static_key_true name = {true}
+#define static_branch_likely(key) likely(READ_ONCE((key)->enabled))
+#define static_branch_unlikely(key) unlikely(READ_ONCE((key)->enabled))
+#define static_branch_enable(key) WRITE_ONCE((key)->enabled, true)
+#define static_branch_disable(key) WRITE_ONCE((key)->enabled, false)
+
+static inline int ilog2(unsigned long long n) {
+    return 63 - __builtin_clzll(n);
+}
+
+// 位图
+
+unsigned long *bitmap_zalloc(unsigned int nbits, gfp_t flags);
+void bitmap_free(const unsigned long *bitmap);
+void bitmap_zero(unsigned long *map, unsigned int nbits);
+void bitmap_clear(unsigned long *map, unsigned int start, unsigned int len);
+void set_bit(long nr, volatile unsigned long *addr);
+unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
+                            unsigned long offset);
+
+// 时间：local_clock 是单调时钟的纳秒数，jiffies 以毫秒为单位（HZ=1000）
+
+#define HZ 1000
+u64 local_clock(void);
+#define jiffies ((unsigned long)(local_clock() / NSEC_PER_MSEC))
+#define msecs_to_jiffies(ms) ((unsigned long)(ms))
+#define jiffies_to_msecs(j) ((unsigned int)(j))
+#define time_after(a, b) ((long)((b) - (a)) < 0)
+#define time_before(a, b) time_after(b, a)
+
+// 进程
+// 每个线程有一个 task_struct，schedule 在线程自己的条件变量上睡眠，直到状态被 wake_up_process 改回运行
+
+#define TASK_RUNNING 0
+#define TASK_INTERRUPTIBLE 1
+#define TASK_UNINTERRUPTIBLE 2
+
+struct task_struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int state;
+    int tgid;
+};
+
+struct task_struct *kshim_current(void);
+#define current kshim_current()
+void set_current_state(int state);
+#define __set_current_state set_current_state
+void schedule(void);
+long schedule_timeout(long timeout);
+int wake_up_process(struct task_struct *p);
+#define signal_pending(p) ((void)(p), 0)
+#define fatal_signal_pending(p) ((void)(p), 0)
+#define need_resched() 0
+#define cond_resched() ((void)0)
+#define cpu_relax() __builtin_ia32_pause()
+#define capable(cap) ((void)(cap), 1)
+#define CAP_SYS_ADMIN 21
+#define CAP_SYS_RESOURCE 24
+
+struct pid;
+#define task_tgid(p) ((struct pid *)(uintptr_t)(p)->tgid)
+
+// 信号量
+
+struct semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+};
+
+void sema_init(struct semaphore *sem, int val);
+void down(struct semaphore *sem);
+int down_interruptible(struct semaphore *sem);
+int down_trylock(struct semaphore *sem);
+void up(struct semaphore *sem);
+
+// 等待队列
+
+struct wait_queue_entry;
+typedef int (*wait_queue_func_t)(struct wait_queue_entry *wq_entry,
+                                 unsigned int mode, int flags, void *key);
+
+#define WQ_FLAG_EXCLUSIVE 0x01
+
+typedef struct wait_queue_entry {
+    unsigned int flags;
+    void *private;
+    wait_queue_func_t func;
+    struct list_head entry;
+} wait_queue_entry_t;
+
+typedef struct wait_queue_head {
+    pthread_mutex_t lock;
+    struct list_head head;
+} wait_queue_head_t;
+
+int autoremove_wake_function(struct wait_queue_entry *wq_entry,
+                             unsigned int mode, int sync, void *key);
+
+#define DEFINE_WAIT(name)                           \
+    struct wait_queue_entry name = {                \
+        .private = current,                         \
+        .func = autoremove_wake_function,           \
+        .entry = LIST_HEAD_INIT((name).entry),      \
+    }
+
+void init_waitqueue_head(struct wait_queue_head *wq_head);
+void prepare_to_wait(struct wait_queue_head *wq_head,
+                     struct wait_queue_entry *wq_entry, int state);
+void prepare_to_wait_exclusive(struct wait_queue_head *wq_head,
+                               struct wait_queue_entry *wq_entry, int state);
+void finish_wait(struct wait_queue_head *wq_head,
+                 struct wait_queue_entry *wq_entry);
+void __wake_up(struct wait_queue_head *wq_head, unsigned int mode, int nr,
+               void *key);
+
+#define poll_to_key(m) ((void *)(uintptr_t)(__poll_t)(m))
+#define wake_up_interruptible(wq) __wake_up(wq, TASK_INTERRUPTIBLE, 1, NULL)
+#define wake_up_interruptible_poll(wq, m) \
+    __wake_up(wq, TASK_INTERRUPTIBLE, 1, poll_to_key(m))
+
+#define __wait_event_loop(wq, condition, prepare, sleep) \
+    ({                                                  \
+        DEFINE_WAIT(__wait);                            \
+        for (;;) {                                      \
+            prepare(&(wq), &__wait, TASK_INTERRUPTIBLE); \
+            if (condition) break;                       \
+            sleep;                                      \
+        }                                               \
+        finish_wait(&(wq), &__wait);                    \
+    })
+
+#define wait_event_interruptible(wq, condition)                            \
+    ({                                                                      \
+        if (!(condition))                                                   \
+            __wait_event_loop(wq, condition, prepare_to_wait, schedule());  \
+        0;                                                                  \
+    })
+
+#define wait_event_interruptible_exclusive(wq, condition)                \
+    ({                                                                    \
+        if (!(condition))                                                 \
+            __wait_event_loop(wq, condition, prepare_to_wait_exclusive,   \
+                              schedule());                                \
+        0;                                                                \
+    })
+
+// 返回值和内核一致：超时时条件仍不成立返回 0，否则返回剩余的时间（至少为 1）
+#define wait_event_interruptible_timeout(wq, condition, timeout)             \
+    ({                                                                        \
+        long __ret = (timeout);                                               \
+        if (!(condition)) {                                                   \
+            DEFINE_WAIT(__wait);                                              \
+            for (;;) {                                                        \
+                prepare_to_wait(&(wq), &__wait, TASK_INTERRUPTIBLE);          \
+                if (condition) break;                                         \
+                __ret = schedule_timeout(__ret);                              \
+                if (!__ret) break;                                            \
+            }                                                                 \
+            finish_wait(&(wq), &__wait);                                      \
+            if ((condition) && !__ret) __ret = 1;                             \
+        } else if (!__ret) {                                                  \
+            __ret = 1;                                                        \
+        }                                                                     \
+        __ret;                                                                \
+    })
+
+// poll：用户空间没有 poll 表，poll_wait 什么都不做，调用者关心所有事件
+
+#define EPOLLIN 0x00000001u
+#define EPOLLPRI 0x00000002u
+#define EPOLLOUT 0x00000004u
+#define EPOLLERR 0x00000008u
+#define EPOLLHUP 0x00000010u
+#define EPOLLRDNORM 0x00000040u
+#define EPOLLWRNORM 0x00000100u
+#define EPOLLRDHUP 0x00002000u
+
+typedef struct poll_table_struct {
+    __poll_t _key;
+} poll_table;
+
+struct file;
+static inline void poll_wait(struct file *filp, wait_queue_head_t *wq,
+                             poll_table *p) {}
+static inline __poll_t poll_requested_events(const poll_table *p) {
+    return p ? p->_key : ~(__poll_t)0;
+}
+
+// 异步通知和 eventfd：没有信号和文件描述符，只保留接口
+
+struct fasync_struct;
+static inline int fasync_helper(int fd, struct file *filp, int on,
+                                struct fasync_struct **fapp) {
+    return 0;
+}
+static inline void kill_fasync(struct fasync_struct **fp, int sig, int band) {}
+
+struct eventfd_ctx;
+static inline struct eventfd_ctx *eventfd_ctx_fdget(int fd) {
+    return ERR_PTR(-EBADF);
+}
+static inline void eventfd_ctx_put(struct eventfd_ctx *ctx) {}
+static inline u64 eventfd_signal(struct eventfd_ctx *ctx, u64 n) { return n; }
+
+// 工作队列：只有类型，使用它们的 compress.c、backing.c、cache.c 不在用户空间编译
+
+struct work_struct {
+    void (*func)(struct work_struct *work);
+};
+struct delayed_work {
+    struct work_struct work;
+};
+
+// 内存回收：注册的 shrinker 可以通过 kshim_shrink 手动触发
+
+#define SHRINK_STOP (~0UL)
+#define SHRINK_EMPTY (~0UL - 1)
+#define DEFAULT_SEEKS 2
+
+struct shrink_control {
+    gfp_t gfp_mask;
+    unsigned long nr_to_scan;
+};
+
+struct shrinker {
+    unsigned long (*count_objects)(struct shrinker *, struct shrink_control *);
+    unsigned long (*scan_objects)(struct shrinker *, struct shrink_control *);
+    int seeks;
+};
+
+int register_shrinker(struct shrinker *shrinker);
+void unregister_shrinker(struct shrinker *shrinker);
+unsigned long kshim_shrink(unsigned long nr_to_scan);
+
+// 迭代器：用户空间和内核空间的缓冲区都是普通内存，iovec 和 kvec 的处理方式相同
+
+#define READ 0
+#define WRITE 1
+
+struct kvec {
+    void *iov_base;
+    size_t iov_len;
+};
+
+struct iov_iter {
+    int type;
+    size_t iov_offset;
+    size_t count;
+    const struct iovec *iov;
+    unsigned long nr_segs;
+};
+
+struct page;
+
+void iov_iter_init(struct iov_iter *i, unsigned int direction,
+                   const struct iovec *iov, unsigned long nr_segs,
+                   size_t count);
+void iov_iter_kvec(struct iov_iter *i, unsigned int direction,
+                   const struct kvec *kvec, unsigned long nr_segs,
+                   size_t count);
+static inline size_t iov_iter_count(const struct iov_iter *i) {
+    return i->count;
+}
+size_t copy_to_iter(const void *addr, size_t bytes, struct iov_iter *i);
+size_t copy_from_iter(void *addr, size_t bytes, struct iov_iter *i);
+size_t iov_iter_zero(size_t bytes, struct iov_iter *i);
+void iov_iter_advance(struct iov_iter *i, size_t bytes);
+void iov_iter_revert(struct iov_iter *i, size_t unroll);
+int import_single_range(int type, void __user *buf, size_t len,
+                        struct iovec *iov, struct iov_iter *i);
+// 没有页面可以固定，直接交接总是退回普通路径
+static inline ssize_t iov_iter_get_pages_alloc(struct iov_iter *i,
+                                               struct page ***pages,
+                                               size_t maxsize, size_t *start) {
+    return -EFAULT;
+}
+static inline size_t copy_page_from_iter(struct page *page, size_t offset,
+                                         size_t bytes, struct iov_iter *i) {
+    return 0;
+}
+static inline void set_page_dirty_lock(struct page *page) {}
+static inline void put_page(struct page *page) {}
+
+// 用户空间访问
+
+#define access_ok(addr, size) ((void)(addr), (void)(size), 1)
+#define u64_to_user_ptr(x) ((void __user *)(uintptr_t)(x))
+static inline unsigned long copy_to_user(void __user *to, const void *from,
+                                         unsigned long n) {
+    memcpy(to, from, n);
+    return 0;
+}
+static inline unsigned long copy_from_user(void *to, const void __user *from,
+                                           unsigned long n) {
+    memcpy(to, from, n);
+    return 0;
+}
+#define put_user(x, ptr) ({ *(ptr) = (x); 0; })
+#define get_user(x, ptr) ({ (x) = *(ptr); 0; })
+#define __put_user put_user
+#define __get_user get_user
+
+// ioctl 命令号，和 asm-generic/ioctl.h 相同
+
+#define _IOC_NRBITS 8
+#define _IOC_TYPEBITS 8
+#define _IOC_SIZEBITS 14
+#define _IOC_NRSHIFT 0
+#define _IOC_TYPESHIFT (_IOC_NRSHIFT + _IOC_NRBITS)
+#define _IOC_SIZESHIFT (_IOC_TYPESHIFT + _IOC_TYPEBITS)
+#define _IOC_DIRSHIFT (_IOC_SIZESHIFT + _IOC_SIZEBITS)
+#define _IOC_NONE 0U
+#define _IOC_WRITE 1U
+#define _IOC_READ 2U
+#define _IOC(dir, type, nr, size)                                  \
+    (((dir) << _IOC_DIRSHIFT) | ((type) << _IOC_TYPESHIFT) |      \
+     ((nr) << _IOC_NRSHIFT) | ((size) << _IOC_SIZESHIFT))
+#define _IO(type, nr) _IOC(_IOC_NONE, (type), (nr), 0)
+#define _IOR(type, nr, size) _IOC(_IOC_READ, (type), (nr), sizeof(size))
+#define _IOW(type, nr, size) _IOC(_IOC_WRITE, (type), (nr), sizeof(size))
+#define _IOWR(type, nr, size) \
+    _IOC(_IOC_READ | _IOC_WRITE, (type), (nr), sizeof(size))
+#define _IOC_TYPE(nr) (((nr) >> _IOC_TYPESHIFT) & ((1 << _IOC_TYPEBITS) - 1))
+#define _IOC_NR(nr) (((nr) >> _IOC_NRSHIFT) & ((1 << _IOC_NRBITS) - 1))
+#define _IOC_SIZE(nr) (((nr) >> _IOC_SIZESHIFT) & ((1 << _IOC_SIZEBITS) - 1))
+#define FIONREAD 0x541B
+
+// 文件和字符设备
+
+#define O_ACCMODE 00000003
+#define O_RDONLY 00000000
+#define O_WRONLY 00000001
+#define O_RDWR 00000002
+#define O_APPEND 00002000
+#define O_NONBLOCK 00004000
+
+#define FMODE_READ 0x1u
+#define FMODE_WRITE 0x2u
+#define FMODE_NOWAIT 0x8000000u
+
+#define IOCB_NOWAIT (1 << 7)
+
+#define S_IRUGO 0444
+
+#define MINORBITS 20
+#define MINORMASK ((1U << MINORBITS) - 1)
+#define MAJOR(dev) ((unsigned int)((dev) >> MINORBITS))
+#define MINOR(dev) ((unsigned int)((dev)&MINORMASK))
+#define MKDEV(ma, mi) (((dev_t)(ma) << MINORBITS) | (mi))
+
+struct module;
+#define THIS_MODULE ((struct module *)0)
+
+struct inode {
+    struct cdev *i_cdev;
+    dev_t i_rdev;
+    void *i_private;
+};
+
+struct file {
+    fmode_t f_mode;
+    unsigned int f_flags;
+    loff_t f_pos;
+    const struct file_operations *f_op;
+    struct inode *f_inode;
+    void *private_data;
+};
+
+struct kiocb {
+    struct file *ki_filp;
+    loff_t ki_pos;
+    int ki_flags;
+};
+
+struct file_operations {
+    struct module *owner;
+    loff_t (*llseek)(struct file *, loff_t, int);
+    ssize_t (*read)(struct file *, char __user *, size_t, loff_t *);
+    ssize_t (*write)(struct file *, const char __user *, size_t, loff_t *);
+    ssize_t (*read_iter)(struct kiocb *, struct iov_iter *);
+    ssize_t (*write_iter)(struct kiocb *, struct iov_iter *);
+    unsigned int (*poll)(struct file *, poll_table *);
+    long (*unlocked_ioctl)(struct file *, unsigned int, unsigned long);
+    int (*open)(struct inode *, struct file *);
+    int (*release)(struct inode *, struct file *);
+    int (*fsync)(struct file *, loff_t, loff_t, int);
+    int (*fasync)(int, struct file *, int);
+};
+
+static inline struct inode *file_inode(const struct file *f) {
+    return f->f_inode;
+}
+#define no_llseek NULL
+#define noop_llseek NULL
+static inline int nonseekable_open(struct inode *inode, struct file *filp) {
+    return 0;
+}
+static inline int simple_open(struct inode *inode, struct file *file) {
+    return 0;
+}
+
+struct cdev {
+    struct module *owner;
+    const struct file_operations *ops;
+    dev_t dev;
+    unsigned int count;
+};
+
+void cdev_init(struct cdev *cdev, const struct file_operations *fops);
+int cdev_add(struct cdev *cdev, dev_t dev, unsigned count);
+void cdev_del(struct cdev *cdev);
+struct cdev *kshim_cdev_lookup(dev_t dev);
+
+// 设备号都可以注册，动态分配的主设备号固定为 240
+static inline int register_chrdev_region(dev_t from, unsigned count,
+                                         const char *name) {
+    return 0;
+}
+static inline int alloc_chrdev_region(dev_t *dev, unsigned baseminor,
+                                      unsigned count, const char *name) {
+    *dev = MKDEV(240, baseminor);
+    return 0;
+}
+static inline void unregister_chrdev_region(dev_t from, unsigned count) {}
+
+// 模块：module_init 和 module_exit 变成可以直接调用的 kshim_module_init 和 kshim_module_exit
+
+#define module_param(name, type, perm)
+#define MODULE_LICENSE(s)
+#define MODULE_AUTHOR(s)
+#define MODULE_DESCRIPTION(s)
+#define module_init(fn) \
+    int kshim_module_init(void) { return fn(); }
+#define module_exit(fn) \
+    void kshim_module_exit(void) { fn(); }
+int kshim_module_init(void);
+void kshim_module_exit(void);
+
+// seq_file、proc 和 debugfs：没有文件系统，创建总是“成功”但什么都不做
+
+struct seq_file {
+    char *buf;
+    size_t size, count;
+    void *private;
+};
+
+#define SEQ_START_TOKEN ((void *)1)
+
+struct seq_operations {
+    void *(*start)(struct seq_file *m, loff_t *pos);
+    void (*stop)(struct seq_file *m, void *v);
+    void *(*next)(struct seq_file *m, void *v, loff_t *pos);
+    int (*show)(struct seq_file *m, void *v);
+};
+
+void seq_printf(struct seq_file *m, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+struct proc_dir_entry;
+static inline struct proc_dir_entry *proc_create_seq(
+    const char *name, unsigned int mode, struct proc_dir_entry *parent,
+    const struct seq_operations *ops) {
+    return NULL;
+}
+static inline void proc_remove(struct proc_dir_entry *de) {}
+
+struct dentry;
+static inline struct dentry *debugfs_create_dir(const char *name,
+                                                struct dentry *parent) {
+    return NULL;
+}
+static inline struct dentry *debugfs_create_file(
+    const char *name, unsigned int mode, struct dentry *parent, void *data,
+    const struct file_operations *fops) {
+    return NULL;
+}
+#define debugfs_create_file_unsafe debugfs_create_file
+static inline void debugfs_remove_recursive(struct dentry *dentry) {}
+
+// 只保留 show 函数的引用，避免未使用的警告
+#define DEFINE_SHOW_ATTRIBUTE(__name)                                    \
+    static int (*const __name##_show_ref)(struct seq_file *, void *)    \
+        __attribute__((unused)) = __name##_show;                        \
+    static const struct file_operations __name##_fops = {.owner = THIS_MODULE}
+#define DEFINE_DEBUGFS_ATTRIBUTE(__fops, __get, __set, __fmt)             \
+    static int (*const __fops##_get_ref)(void *, u64 *)                  \
+        __attribute__((unused)) = __get;                                 \
+    static int (*const __fops##_set_ref)(void *, u64)                    \
+        __attribute__((unused)) = __set;                                 \
+    static const struct file_operations __fops = {.owner = THIS_MODULE}
+
+// 跟踪点：展开成空函数，trace_*_enabled 总是返回假
+
+#define TP_PROTO(args...) args
+#define TP_ARGS(args...) args
+#define DECLARE_EVENT_CLASS(name, proto, args, tstruct, assign, print)
+#define DEFINE_EVENT(template, name, proto, args)                  \
+    static inline void trace_##name(proto) {}                      \
+    static inline bool trace_##name##_enabled(void) { return false; }
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print) \
+    DEFINE_EVENT(name, name, PARAMS(proto), PARAMS(args))
+#define PARAMS(args...) args
+
+#endif
@@ -0,0 +1,3 @@
+// glibc 的 errno.h 也会包含这个文件，先包含系统的版本
+#include_next <linux/errno.h>
+#include "kshim.h"
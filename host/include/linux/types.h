@@ -0,0 +1,3 @@
+// glibc 的头文件也可能包含这个文件，先包含系统的版本
+#include_next <linux/types.h>
+#include "kshim.h"
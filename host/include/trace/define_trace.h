@@ -0,0 +1 @@
+// 跟踪点在用户空间展开成空函数（见 kshim.h），这里不需要再生成任何东西
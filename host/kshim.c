@@ -0,0 +1,491 @@
+#include <malloc.h>
+#include <time.h>
+
+#include "kshim.h"
+
+// 内核接口在用户空间的实现，声明和说明见 include/kshim.h
+
+bool kshim_quiet;
+unsigned long kshim_fail_nth;
+
+// 内存分配
+
+static bool kshim_should_fail(void) {
+    unsigned long n = __atomic_load_n(&kshim_fail_nth, __ATOMIC_RELAXED);
+
+    return n && __atomic_sub_fetch(&kshim_fail_nth, 1, __ATOMIC_RELAXED) == 0;
+}
+
+void *kmalloc(size_t size, gfp_t flags) {
+    if (kshim_should_fail()) return NULL;
+    // 和内核一样，0 字节的分配也返回一个可以释放的指针
+    return malloc(size ? size : 1);
+}
+
+void *kzalloc(size_t size, gfp_t flags) {
+    if (kshim_should_fail()) return NULL;
+    return calloc(1, size ? size : 1);
+}
+
+void *kmalloc_array(size_t n, size_t size, gfp_t flags) {
+    if (size && n > SIZE_MAX / size) return NULL;
+    return kmalloc(n * size, flags);
+}
+
+void *kcalloc(size_t n, size_t size, gfp_t flags) {
+    if (size && n > SIZE_MAX / size) return NULL;
+    return kzalloc(n * size, flags);
+}
+
+void kfree(const void *p) { free((void *)p); }
+
+size_t ksize(const void *p) { return p ? malloc_usable_size((void *)p) : 0; }
+
+// 位图
+
+unsigned long *bitmap_zalloc(unsigned int nbits, gfp_t flags) {
+    return kcalloc(BITS_TO_LONGS(nbits), sizeof(unsigned long), flags);
+}
+
+void bitmap_free(const unsigned long *bitmap) { kfree(bitmap); }
+
+void bitmap_zero(unsigned long *map, unsigned int nbits) {
+    memset(map, 0, BITS_TO_LONGS(nbits) * sizeof(unsigned long));
+}
+
+void bitmap_clear(unsigned long *map, unsigned int start, unsigned int len) {
+    unsigned int i;
+
+    for (i = start; i < start + len; i++)
+        map[i / BITS_PER_LONG] &= ~(1UL << (i % BITS_PER_LONG));
+}
+
+void set_bit(long nr, volatile unsigned long *addr) {
+    __atomic_fetch_or(&addr[nr / BITS_PER_LONG], 1UL << (nr % BITS_PER_LONG),
+                      __ATOMIC_RELAXED);
+}
+
+unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
+                            unsigned long offset) {
+    unsigned long word;
+
+    while (offset < size) {
+        word = addr[offset / BITS_PER_LONG] >> (offset % BITS_PER_LONG);
+        if (word) return min(offset + __builtin_ctzl(word), size);
+        offset = (offset / BITS_PER_LONG + 1) * BITS_PER_LONG;
+    }
+    return size;
+}
+
+// 时间
+
+u64 local_clock(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 进程
+
+static __thread struct task_struct *kshim_task;
+static int kshim_next_tgid;
+static pthread_key_t kshim_task_key;
+static pthread_once_t kshim_task_once = PTHREAD_ONCE_INIT;
+
+// 线程退出时释放，这时它已经不在任何等待队列中
+static void kshim_task_free(void *p) {
+    struct task_struct *task = p;
+
+    pthread_mutex_destroy(&task->lock);
+    pthread_cond_destroy(&task->cond);
+    free(task);
+}
+
+static void kshim_task_key_init(void) {
+    pthread_key_create(&kshim_task_key, kshim_task_free);
+}
+
+struct task_struct *kshim_current(void) {
+    struct task_struct *p = kshim_task;
+
+    if (likely(p)) return p;
+    p = calloc(1, sizeof(*p));
+    if (!p) abort();
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    p->tgid = __atomic_add_fetch(&kshim_next_tgid, 1, __ATOMIC_RELAXED);
+    pthread_once(&kshim_task_once, kshim_task_key_init);
+    pthread_setspecific(kshim_task_key, p);
+    kshim_task = p;
+    return p;
+}
+
+void set_current_state(int state) {
+    struct task_struct *p = current;
+
+    pthread_mutex_lock(&p->lock);
+    p->state = state;
+    pthread_mutex_unlock(&p->lock);
+}
+
+int wake_up_process(struct task_struct *p) {
+    int woken;
+
+    pthread_mutex_lock(&p->lock);
+    woken = p->state != TASK_RUNNING;
+    p->state = TASK_RUNNING;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    return woken;
+}
+
+void schedule(void) {
+    struct task_struct *p = current;
+
+    pthread_mutex_lock(&p->lock);
+    while (p->state != TASK_RUNNING) pthread_cond_wait(&p->cond, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+long schedule_timeout(long timeout) {
+    struct task_struct *p = current;
+    u64 start, elapsed;
+    struct timespec ts;
+
+    if (timeout == MAX_SCHEDULE_TIMEOUT) {
+        schedule();
+        return timeout;
+    }
+    start = local_clock();
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout / 1000;
+    ts.tv_nsec += (timeout % 1000) * NSEC_PER_MSEC;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&p->lock);
+    while (p->state != TASK_RUNNING)
+        if (pthread_cond_timedwait(&p->cond, &p->lock, &ts) == ETIMEDOUT) {
+            p->state = TASK_RUNNING;
+            break;
+        }
+    pthread_mutex_unlock(&p->lock);
+    elapsed = (local_clock() - start) / NSEC_PER_MSEC;
+    return elapsed >= (u64)timeout ? 0 : timeout - elapsed;
+}
+
+// 信号量
+
+void sema_init(struct semaphore *sem, int val) {
+    pthread_mutex_init(&sem->lock, NULL);
+    pthread_cond_init(&sem->cond, NULL);
+    sem->count = val;
+}
+
+void down(struct semaphore *sem) {
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count <= 0) pthread_cond_wait(&sem->cond, &sem->lock);
+    sem->count--;
+    pthread_mutex_unlock(&sem->lock);
+}
+
+// 用户空间没有信号，总是成功
+int down_interruptible(struct semaphore *sem) {
+    down(sem);
+    return 0;
+}
+
+// 和内核一样，成功返回 0，拿不到返回 1
+int down_trylock(struct semaphore *sem) {
+    int busy;
+
+    pthread_mutex_lock(&sem->lock);
+    busy = sem->count <= 0;
+    if (!busy) sem->count--;
+    pthread_mutex_unlock(&sem->lock);
+    return busy;
+}
+
+void up(struct semaphore *sem) {
+    pthread_mutex_lock(&sem->lock);
+    sem->count++;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->lock);
+}
+
+// 等待队列
+// 和内核相同：非独占的等待者在队列前面，独占的在后面，唤醒时最多唤醒 nr 个独占的等待者
+
+void init_waitqueue_head(struct wait_queue_head *wq_head) {
+    pthread_mutex_init(&wq_head->lock, NULL);
+    INIT_LIST_HEAD(&wq_head->head);
+}
+
+int autoremove_wake_function(struct wait_queue_entry *wq_entry,
+                             unsigned int mode, int sync, void *key) {
+    int ret = wake_up_process(wq_entry->private);
+
+    if (ret) list_del_init(&wq_entry->entry);
+    return ret;
+}
+
+static void kshim_prepare(struct wait_queue_head *wq_head,
+                          struct wait_queue_entry *wq_entry, int state,
+                          bool exclusive) {
+    pthread_mutex_lock(&wq_head->lock);
+    if (list_empty(&wq_entry->entry)) {
+        if (exclusive) {
+            wq_entry->flags |= WQ_FLAG_EXCLUSIVE;
+            list_add_tail(&wq_entry->entry, &wq_head->head);
+        } else {
+            wq_entry->flags &= ~WQ_FLAG_EXCLUSIVE;
+            list_add(&wq_entry->entry, &wq_head->head);
+        }
+    }
+    // 在队列锁内设置状态，唤醒者看到等待项时一定也能看到新状态
+    set_current_state(state);
+    pthread_mutex_unlock(&wq_head->lock);
+}
+
+void prepare_to_wait(struct wait_queue_head *wq_head,
+                     struct wait_queue_entry *wq_entry, int state) {
+    kshim_prepare(wq_head, wq_entry, state, false);
+}
+
+void prepare_to_wait_exclusive(struct wait_queue_head *wq_head,
+                               struct wait_queue_entry *wq_entry, int state) {
+    kshim_prepare(wq_head, wq_entry, state, true);
+}
+
+void finish_wait(struct wait_queue_head *wq_head,
+                 struct wait_queue_entry *wq_entry) {
+    set_current_state(TASK_RUNNING);
+    pthread_mutex_lock(&wq_head->lock);
+    if (!list_empty(&wq_entry->entry)) list_del_init(&wq_entry->entry);
+    pthread_mutex_unlock(&wq_head->lock);
+}
+
+void __wake_up(struct wait_queue_head *wq_head, unsigned int mode, int nr,
+               void *key) {
+    struct wait_queue_entry *curr, *next;
+    unsigned int flags;
+
+    pthread_mutex_lock(&wq_head->lock);
+    list_for_each_entry_safe(curr, next, &wq_head->head, entry) {
+        // 回调可能把等待项从队列中删除，先保存标志
+        flags = curr->flags;
+        if (curr->func(curr, mode, 0, key) > 0 &&
+            (flags & WQ_FLAG_EXCLUSIVE) && !--nr)
+            break;
+    }
+    pthread_mutex_unlock(&wq_head->lock);
+}
+
+// 迭代器
+
+static void kshim_iov_init(struct iov_iter *i, unsigned int direction,
+                           const struct iovec *iov, unsigned long nr_segs,
+                           size_t count) {
+    i->type = direction;
+    i->iov = iov;
+    i->nr_segs = nr_segs;
+    i->iov_offset = 0;
+    i->count = count;
+}
+
+void iov_iter_init(struct iov_iter *i, unsigned int direction,
+                   const struct iovec *iov, unsigned long nr_segs,
+                   size_t count) {
+    kshim_iov_init(i, direction, iov, nr_segs, count);
+}
+
+// struct kvec 和 struct iovec 的布局相同
+void iov_iter_kvec(struct iov_iter *i, unsigned int direction,
+                   const struct kvec *kvec, unsigned long nr_segs,
+                   size_t count) {
+    kshim_iov_init(i, direction, (const struct iovec *)kvec, nr_segs, count);
+}
+
+enum { KSHIM_TO, KSHIM_FROM, KSHIM_ZERO, KSHIM_SKIP };
+
+// 按段处理 bytes 个字节：复制到迭代器、从迭代器复制、填零或者只前进
+static size_t kshim_iterate(struct iov_iter *i, size_t bytes, char *addr,
+                            int op) {
+    size_t done = 0, n;
+    char *base;
+
+    bytes = min(bytes, i->count);
+    while (done < bytes) {
+        n = min(bytes - done, i->iov->iov_len - i->iov_offset);
+        base = (char *)i->iov->iov_base + i->iov_offset;
+        if (op == KSHIM_TO)
+            memcpy(base, addr + done, n);
+        else if (op == KSHIM_FROM)
+            memcpy(addr + done, base, n);
+        else if (op == KSHIM_ZERO)
+            memset(base, 0, n);
+        done += n;
+        i->iov_offset += n;
+        if (i->iov_offset == i->iov->iov_len) {
+            i->iov++;
+            i->nr_segs--;
+            i->iov_offset = 0;
+        }
+    }
+    i->count -= done;
+    return done;
+}
+
+size_t copy_to_iter(const void *addr, size_t bytes, struct iov_iter *i) {
+    return kshim_iterate(i, bytes, (char *)addr, KSHIM_TO);
+}
+
+size_t copy_from_iter(void *addr, size_t bytes, struct iov_iter *i) {
+    return kshim_iterate(i, bytes, addr, KSHIM_FROM);
+}
+
+size_t iov_iter_zero(size_t bytes, struct iov_iter *i) {
+    return kshim_iterate(i, bytes, NULL, KSHIM_ZERO);
+}
+
+void iov_iter_advance(struct iov_iter *i, size_t bytes) {
+    kshim_iterate(i, bytes, NULL, KSHIM_SKIP);
+}
+
+// 退回 unroll 个字节，可能退回到前面的段
+void iov_iter_revert(struct iov_iter *i, size_t unroll) {
+    i->count += unroll;
+    while (unroll > i->iov_offset) {
+        unroll -= i->iov_offset;
+        i->iov--;
+        i->nr_segs++;
+        i->iov_offset = i->iov->iov_len;
+    }
+    i->iov_offset -= unroll;
+}
+
+int import_single_range(int type, void __user *buf, size_t len,
+                        struct iovec *iov, struct iov_iter *i) {
+    iov->iov_base = buf;
+    iov->iov_len = len;
+    iov_iter_init(i, type, iov, 1, len);
+    return 0;
+}
+
+// 字符设备：按设备号登记，打开文件时按设备号查找
+
+#define KSHIM_MAX_CDEVS 64
+
+static struct cdev *kshim_cdevs[KSHIM_MAX_CDEVS];
+static pthread_mutex_t kshim_cdev_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void cdev_init(struct cdev *cdev, const struct file_operations *fops) {
+    memset(cdev, 0, sizeof(*cdev));
+    cdev->ops = fops;
+}
+
+int cdev_add(struct cdev *cdev, dev_t dev, unsigned count) {
+    int i, ret = -EBUSY;
+
+    cdev->dev = dev;
+    cdev->count = count;
+    pthread_mutex_lock(&kshim_cdev_lock);
+    for (i = 0; i < KSHIM_MAX_CDEVS; i++)
+        if (!kshim_cdevs[i]) {
+            kshim_cdevs[i] = cdev;
+            ret = 0;
+            break;
+        }
+    pthread_mutex_unlock(&kshim_cdev_lock);
+    return ret;
+}
+
+void cdev_del(struct cdev *cdev) {
+    int i;
+
+    pthread_mutex_lock(&kshim_cdev_lock);
+    for (i = 0; i < KSHIM_MAX_CDEVS; i++)
+        if (kshim_cdevs[i] == cdev) kshim_cdevs[i] = NULL;
+    pthread_mutex_unlock(&kshim_cdev_lock);
+}
+
+struct cdev *kshim_cdev_lookup(dev_t dev) {
+    struct cdev *cdev = NULL;
+    int i;
+
+    pthread_mutex_lock(&kshim_cdev_lock);
+    for (i = 0; i < KSHIM_MAX_CDEVS; i++)
+        if (kshim_cdevs[i] && dev >= kshim_cdevs[i]->dev &&
+            dev < kshim_cdevs[i]->dev + kshim_cdevs[i]->count) {
+            cdev = kshim_cdevs[i];
+            break;
+        }
+    pthread_mutex_unlock(&kshim_cdev_lock);
+    return cdev;
+}
+
+// 内存回收
+
+#define KSHIM_MAX_SHRINKERS 8
+
+static struct shrinker *kshim_shrinkers[KSHIM_MAX_SHRINKERS];
+static pthread_mutex_t kshim_shrinker_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int register_shrinker(struct shrinker *shrinker) {
+    int i, ret = -ENOMEM;
+
+    pthread_mutex_lock(&kshim_shrinker_lock);
+    for (i = 0; i < KSHIM_MAX_SHRINKERS; i++)
+        if (!kshim_shrinkers[i]) {
+            kshim_shrinkers[i] = shrinker;
+            ret = 0;
+            break;
+        }
+    pthread_mutex_unlock(&kshim_shrinker_lock);
+    return ret;
+}
+
+void unregister_shrinker(struct shrinker *shrinker) {
+    int i;
+
+    pthread_mutex_lock(&kshim_shrinker_lock);
+    for (i = 0; i < KSHIM_MAX_SHRINKERS; i++)
+        if (kshim_shrinkers[i] == shrinker) kshim_shrinkers[i] = NULL;
+    pthread_mutex_unlock(&kshim_shrinker_lock);
+}
+
+// 让每个 shrinker 最多回收 nr_to_scan 个对象，返回回收的总数
+unsigned long kshim_shrink(unsigned long nr_to_scan) {
+    struct shrink_control sc = {.gfp_mask = GFP_KERNEL};
+    unsigned long count, freed, total = 0;
+    struct shrinker *s;
+    int i;
+
+    pthread_mutex_lock(&kshim_shrinker_lock);
+    for (i = 0; i < KSHIM_MAX_SHRINKERS; i++) {
+        s = kshim_shrinkers[i];
+        if (!s) continue;
+        count = s->count_objects(s, &sc);
+        if (!count || count == SHRINK_EMPTY) continue;
+        sc.nr_to_scan = min(count, nr_to_scan);
+        freed = s->scan_objects(s, &sc);
+        if (freed != SHRINK_STOP) total += freed;
+    }
+    pthread_mutex_unlock(&kshim_shrinker_lock);
+    return total;
+}
+
+// seq_file：输出追加到 buf，超出时截断
+
+void seq_printf(struct seq_file *m, const char *fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (!m->buf || m->count >= m->size) return;
+    va_start(ap, fmt);
+    n = vsnprintf(m->buf + m->count, m->size - m->count, fmt, ap);
+    va_end(ap);
+    if (n > 0) m->count = min(m->count + n, m->size);
+}
@@ -0,0 +1,31 @@
+#ifndef SCULL_HOST_H
+#define SCULL_HOST_H
+
+// 用户空间运行 scull 的接口，代替 VFS 调用驱动的文件操作
+// 打开、读写、ioctl 的参数和返回值与系统调用一致，错误返回负的错误码
+
+#include "kshim.h"
+#include "scull.h"
+
+// 加载和卸载“模块”，相当于 insmod 和 rmmod
+int scull_host_init(void);
+void scull_host_exit(void);
+
+// scull 设备 i 和管道 i 的设备号
+dev_t scull_host_dev(int i);
+dev_t scull_host_pipe(int i);
+
+// 打开设备，flags 是 O_RDONLY、O_WRONLY、O_RDWR 和 O_NONBLOCK 的组合，失败时返回 ERR_PTR
+struct file *scull_host_open(dev_t devno, unsigned int flags);
+int scull_host_close(struct file *filp);
+
+ssize_t scull_host_read(struct file *filp, void *buf, size_t count);
+ssize_t scull_host_write(struct file *filp, const void *buf, size_t count);
+ssize_t scull_host_pread(struct file *filp, void *buf, size_t count, loff_t pos);
+ssize_t scull_host_pwrite(struct file *filp, const void *buf, size_t count,
+                          loff_t pos);
+loff_t scull_host_lseek(struct file *filp, loff_t off, int whence);
+long scull_host_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
+unsigned int scull_host_poll(struct file *filp);
+
+#endif
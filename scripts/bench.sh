@@ -0,0 +1,22 @@
+#!/bin/bash
+# 运行所有性能测试，结果输出到标准输出，编译信息输出到标准错误
+# 用法：scripts/bench.sh [csv|json]
+set -e
+make -j $(nproc) -C bench all >&2
+cd bench/build
+
+run() {
+    for b in ./*; do
+        echo "[$b]" >&2
+        sudo $b $*
+    done
+}
+
+if [ "$1" = "json" ]; then
+    echo "["
+    run -j | sed '$!s/$/,/'
+    echo "]"
+else
+    echo "bench,case,quantum,size,threads,ops,mb_s,p50_ns,p99_ns,p999_ns"
+    run
+fi
@@ -0,0 +1,24 @@
+#!/bin/bash
+# 在 QEMU 中运行 KUnit 测试
+# 用法：scripts/kunit.sh 内核源码目录 [kunit.py run 的其他参数]
+# 需要带 kunit.py QEMU 支持的内核（5.12 以后，例如 5.15）；5.4 还没有 KUnit。
+# 把仓库作为 drivers/misc/scull 接入内核源码树，编译进内核后由 kunit.py 启动 QEMU 运行
+set -e
+KDIR=${1:?usage: scripts/kunit.sh KDIR [kunit.py args]}
+shift
+REPO=$(cd "$(dirname "$0")/.." && pwd)
+DEST=$KDIR/drivers/misc/scull
+
+mkdir -p "$DEST"
+ln -sfn "$REPO/src" "$DEST/src"
+for f in Kbuild Kconfig .kunitconfig; do
+    ln -sf "$REPO/kunit/$f" "$DEST/$f"
+done
+grep -q 'drivers/misc/scull/Kconfig' "$KDIR/drivers/misc/Kconfig" ||
+    sed -i '$i source "drivers/misc/scull/Kconfig"' "$KDIR/drivers/misc/Kconfig"
+grep -q 'scull/' "$KDIR/drivers/misc/Makefile" ||
+    echo 'obj-$(CONFIG_SCULL) += scull/' >>"$KDIR/drivers/misc/Makefile"
+
+cd "$KDIR"
+./tools/testing/kunit/kunit.py run --arch=x86_64 \
+    --kunitconfig=drivers/misc/scull "$@"
@@ -8,6 +8,9 @@ set -e
 # 检查模块是否加载
 lsmod | grep -q scull && exit 1
 
+# 冷量子压缩依赖内核的 LZ4 库，可能编译成了模块
+sudo /sbin/modprobe -a lz4_compress lz4_decompress 2>/dev/null || true
+
 # 加载模块
 sudo /sbin/insmod ./$module.ko $* || exit 1
 
@@ -33,5 +36,12 @@ sudo mknod /dev/${device}pipe3 c $major 7
 
 sudo -E chown $USER:$USER /dev/${device}pipe[0-3]
 
+# 创建私有设备：每个进程一个的 scullpriv 和每次打开一个的 scullfd
+sudo rm -f /dev/${device}priv /dev/${device}fd
+sudo mknod /dev/${device}priv c $major 8
+sudo mknod /dev/${device}fd c $major 9
+
+sudo -E chown $USER:$USER /dev/${device}priv /dev/${device}fd
+
 
 
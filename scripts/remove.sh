@@ -11,6 +11,8 @@ sudo rm -f /dev/${device} /dev/${device}[0-3]
 
 sudo rm -f /dev/${device} /dev/${device}pipe[0-3] 
 
+sudo rm -f /dev/${device}priv /dev/${device}fd
+
 
 
 
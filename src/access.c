@@ -0,0 +1,232 @@
+#include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/hashtable.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/pid.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+#include "scull.h"
+#include "scull_trace.h"
+
+// 访问控制的设备变体，参考 LDD3 的 access.c
+// scullpriv：每个进程一个私有设备，同一个进程（线程组）的多次打开看到同一个设备，
+//            所有打开的文件都关闭后释放
+// scullfd：  每次打开得到一个新的私有设备，关闭时释放
+// 私有设备在打开时创建，互相之间不共享互斥锁和量子集合，各自使用暂存区的进程不会竞争同一把锁。
+// 私有设备不出现在 /proc/scullmem 中，也不参与后台压缩；统计计数按变体汇总，
+// 在 debugfs 的 scullpriv 和 scullfd 目录下
+
+// 一个私有设备
+struct scull_listitem {
+    struct scull_dev device;
+    struct pid *key;         // 所属的进程，scullfd 的设备为 NULL
+    unsigned int users;      // 打开的文件数量，由 scull_priv_lock 保护
+    struct hlist_node node;  // 链接到 scull_priv_table
+};
+
+// 按进程查找 scullpriv 的私有设备
+// 键是进程的 struct pid，持有它的引用期间地址不会被重用，不会和退出后重用了进程号的新进程混淆
+static DEFINE_HASHTABLE(scull_priv_table, 6);
+static DEFINE_MUTEX(scull_priv_lock);
+
+// 创建私有设备，参数和 scull0 等静态设备相同。dev 是变体自己的设备结构
+static struct scull_listitem *scull_priv_alloc(struct scull_dev *dev,
+                                               struct inode *inode) {
+    struct scull_listitem *item;
+
+    item = kzalloc(sizeof(*item), GFP_KERNEL_ACCOUNT);
+    if (!item) return NULL;
+    item->device.quantum = scull_quantum;
+    item->device.qset = scull_qset;
+    item->device.limit = scull_limit;
+    // 同一个变体的私有设备共用计数器
+    item->device.stats = dev->stats;
+    // 只用于跟踪点输出设备号，私有设备不加入系统
+    item->device.cdev.dev = inode->i_rdev;
+    sema_init(&item->device.sem, 1);
+    scull_wb_init(&item->device);
+    scull_cache_setup(&item->device);
+    return item;
+}
+
+// 释放私有设备，已经没有文件引用它
+static void scull_priv_free(struct scull_listitem *item) {
+    scull_cache_release(&item->device);
+    scull_wb_cleanup(&item->device);
+    scull_trim(&item->device);
+    scull_kv_clear(&item->device);
+    put_pid(item->key);
+    kfree(item);
+}
+
+static struct scull_listitem *scull_priv_lookup(struct pid *key) {
+    struct scull_listitem *item;
+
+    hash_for_each_possible(scull_priv_table, item, node, hash_ptr(key, 32))
+        if (item->key == key) return item;
+    return NULL;
+}
+
+static void scull_priv_setup_file(struct scull_dev *dev, struct file *filp) {
+    filp->private_data = dev;
+    filp->f_mode |= FMODE_NOWAIT;
+    trace_scull_open(dev->cdev.dev, filp->f_mode);
+}
+
+static int scull_priv_release(struct inode *inode, struct file *filp) {
+    struct scull_listitem *item =
+        container_of(filp->private_data, struct scull_listitem, device);
+    bool last;
+
+    trace_scull_release(inode->i_rdev, filp->f_mode);
+    mutex_lock(&scull_priv_lock);
+    last = !--item->users;
+    if (last) hash_del(&item->node);
+    mutex_unlock(&scull_priv_lock);
+    // 释放可能要写回后备文件，不在全局锁内进行
+    if (last) scull_priv_free(item);
+    return 0;
+}
+
+static int scull_priv_open(struct inode *inode, struct file *filp) {
+    struct scull_dev *dev = container_of(inode->i_cdev, struct scull_dev, cdev);
+    struct pid *key = task_tgid(current);
+    struct scull_listitem *item;
+
+    mutex_lock(&scull_priv_lock);
+    item = scull_priv_lookup(key);
+    if (!item) {
+        item = scull_priv_alloc(dev, inode);
+        if (!item) {
+            mutex_unlock(&scull_priv_lock);
+            return -ENOMEM;
+        }
+        item->key = get_pid(key);
+        hash_add(scull_priv_table, &item->node, hash_ptr(key, 32));
+    }
+    item->users++;
+    mutex_unlock(&scull_priv_lock);
+
+    scull_priv_setup_file(&item->device, filp);
+    // 和 scull_open 一样，只写打开时清空设备
+    if ((filp->f_flags & O_ACCMODE) == O_WRONLY) {
+        if (down_interruptible(&item->device.sem)) {
+            scull_priv_release(inode, filp);
+            return -ERESTARTSYS;
+        }
+        scull_trim(&item->device);
+        up(&item->device.sem);
+    }
+    return 0;
+}
+
+static int scull_fd_open(struct inode *inode, struct file *filp) {
+    struct scull_dev *dev = container_of(inode->i_cdev, struct scull_dev, cdev);
+    struct scull_listitem *item;
+
+    item = scull_priv_alloc(dev, inode);
+    if (!item) return -ENOMEM;
+    // 新设备是空的，只写打开时不需要清空
+    scull_priv_setup_file(&item->device, filp);
+    return 0;
+}
+
+static int scull_fd_release(struct inode *inode, struct file *filp) {
+    trace_scull_release(inode->i_rdev, filp->f_mode);
+    scull_priv_free(
+        container_of(filp->private_data, struct scull_listitem, device));
+    return 0;
+}
+
+// 除了打开和关闭，其余操作和 scull 设备相同
+static struct file_operations scull_priv_fops = {
+    .owner = THIS_MODULE,
+    .llseek = scull_llseek,
+    .read_iter = scull_read_iter,
+    .write_iter = scull_write_iter,
+    .unlocked_ioctl = scull_ioctl,
+    .fsync = scull_fsync,
+    .open = scull_priv_open,
+    .release = scull_priv_release,
+};
+
+static struct file_operations scull_fd_fops = {
+    .owner = THIS_MODULE,
+    .llseek = scull_llseek,
+    .read_iter = scull_read_iter,
+    .write_iter = scull_write_iter,
+    .unlocked_ioctl = scull_ioctl,
+    .fsync = scull_fsync,
+    .open = scull_fd_open,
+    .release = scull_fd_release,
+};
+
+// 变体的设备结构只用来注册字符设备和保存计数器，不存放数据
+static struct scull_dev scull_priv_dev, scull_fd_dev;
+
+static struct scull_adev_info {
+    char *name;
+    struct scull_dev *sculldev;
+    struct file_operations *fops;
+    bool added;  // 字符设备是否加入了系统
+} scull_access_devs[] = {
+    {"scullpriv", &scull_priv_dev, &scull_priv_fops},
+    {"scullfd", &scull_fd_dev, &scull_fd_fops},
+};
+#define SCULL_N_ADEVS ARRAY_SIZE(scull_access_devs)
+
+static dev_t scull_a_firstdev;
+
+// 设置一个变体，失败时这个变体不可用
+static void scull_access_setup(dev_t devno, struct scull_adev_info *devinfo) {
+    struct scull_dev *dev = devinfo->sculldev;
+    int err;
+
+    dev->stats = alloc_percpu(struct scull_stats);
+    if (!dev->stats) {
+        printk(KERN_NOTICE "Unable to allocate stats for %s\n", devinfo->name);
+        return;
+    }
+    scull_stats_register(devinfo->name, dev->stats);
+
+    cdev_init(&dev->cdev, devinfo->fops);
+    dev->cdev.owner = THIS_MODULE;
+    err = cdev_add(&dev->cdev, devno, 1);
+    if (err)
+        printk(KERN_NOTICE "Error %d adding %s\n", err, devinfo->name);
+    else
+        devinfo->added = true;
+}
+
+// 初始化访问控制设备，返回设备数量
+int scull_access_init(dev_t firstdev) {
+    int result, i;
+
+    result = register_chrdev_region(firstdev, SCULL_N_ADEVS, "sculla");
+    if (result < 0) {
+        printk(KERN_WARNING "sculla: device number registration failed\n");
+        return 0;
+    }
+    scull_a_firstdev = firstdev;
+
+    for (i = 0; i < SCULL_N_ADEVS; i++)
+        scull_access_setup(firstdev + i, scull_access_devs + i);
+    return SCULL_N_ADEVS;
+}
+
+// 模块卸载时没有打开的文件，所有私有设备都已经释放
+void scull_access_cleanup(void) {
+    struct scull_dev *dev;
+    int i;
+
+    if (!scull_a_firstdev) return;
+    for (i = 0; i < SCULL_N_ADEVS; i++) {
+        dev = scull_access_devs[i].sculldev;
+        if (scull_access_devs[i].added) cdev_del(&dev->cdev);
+        free_percpu(dev->stats);
+    }
+    unregister_chrdev_region(scull_a_firstdev, SCULL_N_ADEVS);
+}
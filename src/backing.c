@@ -0,0 +1,228 @@
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/uio.h>
+#include <linux/workqueue.h>
+
+#include "scull.h"
+
+// 后备文件
+// 设备绑定后备文件时先从文件加载内容，之后写入的量子被标记为脏（SCULL_Q_DIRTY），
+// 并调度后台写回。写回在 scull_wb_ms 毫秒后一次处理这段时间内修改过的所有量子，
+// 同一个量子的多次写入只写回一次。清空设备时记下需要截断文件，由下一次写回完成。
+// 写回持有设备的互斥锁，所以后备文件只能是普通文件，不能是 scull 设备本身
+
+static unsigned int scull_wb_ms = 1000;  // 写入后多久开始写回（毫秒）
+module_param(scull_wb_ms, uint, S_IRUGO);
+
+// 标记量子为脏，调用者持有互斥锁，设备绑定了后备文件
+void scull_wb_dirty(struct scull_dev *dev, struct scull_qmeta *m) {
+    // 已经是脏的说明写回已经调度，多次写入合并成一次写回
+    if (m->flags & SCULL_Q_DIRTY) return;
+    m->flags |= SCULL_Q_DIRTY;
+    schedule_delayed_work(&dev->wb_work, msecs_to_jiffies(scull_wb_ms));
+}
+
+// 设备被清空，文件中原来的内容全部作废。调用者持有互斥锁
+void scull_wb_truncate(struct scull_dev *dev) {
+    dev->wb_trunc = 0;
+    schedule_delayed_work(&dev->wb_work, msecs_to_jiffies(scull_wb_ms));
+}
+
+// 把脏量子写回后备文件，调用者持有互斥锁
+// 出错时没有写回的量子保持为脏，下一次重试
+static int scull_wb_pass(struct scull_dev *dev) {
+    struct file *f = dev->backing;
+    struct scull_qset *dptr;
+    struct scull_qmeta *m;
+    void *zero = NULL;
+    const void *buf;
+    loff_t k = 0, pos;
+    ssize_t len, ret;
+    int i, err = 0;
+
+    if (!f) return 0;
+    if (dev->wb_trunc >= 0) {
+        err = vfs_truncate(&f->f_path, dev->wb_trunc);
+        if (err) return err;
+        dev->wb_trunc = -1;
+    }
+    for (dptr = dev->data; dptr; dptr = dptr->next, k += dev->qset) {
+        if (!dptr->data) continue;
+        for (i = 0; i < dev->qset; i++) {
+            m = &dptr->meta[i];
+            if (!(m->flags & SCULL_Q_DIRTY)) continue;
+            pos = (k + i) * dev->quantum;
+            len = min_t(loff_t, dev->quantum, dev->size - pos);
+            // 脏量子不会被压缩，共享的量子直接写出共享的内容
+            buf = dptr->data[i];
+            if (!buf) {
+                // 变成空洞的量子写入零
+                if (!zero) zero = kvzalloc(dev->quantum, GFP_KERNEL);
+                if (!zero) {
+                    err = -ENOMEM;
+                    goto out;
+                }
+                buf = zero;
+            }
+            if (len > 0) {
+                ret = kernel_write(f, buf, len, &pos);
+                if (ret != len) {
+                    err = ret < 0 ? ret : -EIO;
+                    goto out;
+                }
+                scull_stat_add(dev->stats, SCULL_STAT_WRITEBACK, 1);
+            }
+            m->flags &= ~SCULL_Q_DIRTY;
+        }
+        cond_resched();
+    }
+out:
+    kvfree(zero);
+    return err;
+}
+
+static void scull_wb_work_fn(struct work_struct *work) {
+    struct scull_dev *dev =
+        container_of(to_delayed_work(work), struct scull_dev, wb_work);
+    int err;
+
+    down(&dev->sem);
+    err = scull_wb_pass(dev);
+    if (err) {
+        pr_warn_ratelimited("scull: writeback failed: %d\n", err);
+        if (dev->backing)
+            schedule_delayed_work(&dev->wb_work, msecs_to_jiffies(scull_wb_ms));
+    }
+    up(&dev->sem);
+}
+
+// 从文件加载内容，全零的块保持为空洞。调用者持有互斥锁，设备是空的
+static int scull_wb_load(struct scull_dev *dev, struct file *f) {
+    loff_t size = i_size_read(file_inode(f)), pos = 0, off;
+    struct iov_iter iter;
+    struct kvec kv;
+    ssize_t len, ret;
+    void *buf;
+    int err = 0;
+
+    buf = kvmalloc(dev->quantum, GFP_KERNEL);
+    if (!buf) return -ENOMEM;
+    while (pos < size) {
+        if (fatal_signal_pending(current)) {
+            err = -EINTR;
+            break;
+        }
+        off = pos;
+        len = kernel_read(f, buf, min_t(loff_t, dev->quantum, size - pos), &off);
+        if (len < 0) {
+            err = len;
+            break;
+        }
+        // 文件在加载过程中变短了
+        if (len == 0) break;
+        if (!memchr_inv(buf, 0, len)) {
+            pos += len;
+            continue;
+        }
+        kv.iov_base = buf;
+        kv.iov_len = len;
+        iov_iter_kvec(&iter, WRITE, &kv, 1, len);
+        // 读到的块可能跨越量子的边界，分几次写入
+        while (iov_iter_count(&iter)) {
+            ret = scull_write_locked(dev, pos, &iter);
+            if (ret < 0) {
+                err = ret;
+                goto out;
+            }
+            pos += ret;
+        }
+        cond_resched();
+    }
+out:
+    kvfree(buf);
+    if (!err) dev->size = pos;
+    return err;
+}
+
+// 绑定后备文件，fd 为负数时解除绑定
+// 原来绑定的文件先写回；加载失败时设备保持为空，不绑定任何文件
+int scull_wb_bind(struct scull_dev *dev, int fd) {
+    struct file *f = NULL, *old = NULL;
+    int err = 0;
+
+    if (fd >= 0) {
+        f = fget(fd);
+        if (!f) return -EBADF;
+        // 写回按偏移量写入，需要可读写、非追加的普通文件
+        if (!S_ISREG(file_inode(f)->i_mode) || (f->f_flags & O_APPEND)) {
+            err = -EINVAL;
+            goto out_put;
+        }
+        if ((f->f_mode & (FMODE_READ | FMODE_WRITE)) !=
+            (FMODE_READ | FMODE_WRITE)) {
+            err = -EBADF;
+            goto out_put;
+        }
+    }
+
+    if (down_interruptible(&dev->sem)) {
+        err = -ERESTARTSYS;
+        goto out_put;
+    }
+    err = scull_wb_pass(dev);
+    if (err) goto out;
+    old = dev->backing;
+    dev->backing = NULL;
+    if (f) {
+        scull_trim(dev);
+        err = scull_wb_load(dev, f);
+        if (err) {
+            scull_trim(dev);
+            goto out;
+        }
+        dev->backing = f;
+        dev->wb_trunc = -1;
+        f = NULL;
+    }
+out:
+    up(&dev->sem);
+    if (old) fput(old);
+out_put:
+    if (f) fput(f);
+    return err;
+}
+
+// 立即写回并同步后备文件
+int scull_wb_flush(struct scull_dev *dev) {
+    int err;
+
+    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+    err = scull_wb_pass(dev);
+    if (!err && dev->backing) err = vfs_fsync(dev->backing, 0);
+    up(&dev->sem);
+    return err;
+}
+
+void scull_wb_init(struct scull_dev *dev) {
+    dev->wb_trunc = -1;
+    INIT_DELAYED_WORK(&dev->wb_work, scull_wb_work_fn);
+}
+
+// 模块卸载时调用，设备已经没有用户：停止后台写回，把剩下的修改写回文件
+void scull_wb_cleanup(struct scull_dev *dev) {
+    int err;
+
+    cancel_delayed_work_sync(&dev->wb_work);
+    if (!dev->backing) return;
+    err = scull_wb_pass(dev);
+    if (err) pr_warn("scull: final writeback failed: %d\n", err);
+    fput(dev->backing);
+    dev->backing = NULL;
+}
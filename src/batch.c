@@ -0,0 +1,100 @@
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+#include <linux/uio.h>
+
+#include "scull.h"
+
+// 批量读写
+// 一次 ioctl 执行一组分散的读写：只加一次锁，并且按偏移量排序后执行，
+// 配合 scull_follow 记住的位置，整个批次只需要沿着量子集合链表走一遍
+
+// 按偏移量排序，偏移量相同时保持数组中的顺序
+static int scull_io_cmp(const void *a, const void *b) {
+    const struct scull_io *x = *(const struct scull_io **)a;
+    const struct scull_io *y = *(const struct scull_io **)b;
+
+    if (x->off != y->off) return x->off < y->off ? -1 : 1;
+    return x < y ? -1 : x > y;
+}
+
+// 执行一项读写，调用者持有互斥锁
+static s64 scull_io_one(struct file *filp, struct scull_io *io) {
+    struct scull_dev *dev = filp->private_data;
+    bool write = io->flags & SCULL_IO_WRITE;
+    loff_t pos = io->off;
+    struct iov_iter iter;
+    struct iovec iov;
+    ssize_t ret;
+    s64 done = 0;
+
+    if (io->flags & ~SCULL_IO_WRITE) return -EINVAL;
+    if (pos < 0) return -EINVAL;
+    if (!(filp->f_mode & (write ? FMODE_WRITE : FMODE_READ))) return -EBADF;
+    ret = import_single_range(write ? WRITE : READ, u64_to_user_ptr(io->buf),
+                              io->len, &iov, &iter);
+    if (ret) return ret;
+
+    // scull_read_locked 和 scull_write_locked 每次最多处理一个量子
+    while (iov_iter_count(&iter)) {
+        ret = write ? scull_write_locked(dev, pos, &iter)
+                    : scull_read_locked(dev, pos, &iter);
+        if (ret <= 0) break;
+        pos += ret;
+        done += ret;
+    }
+    scull_stat_add(dev->stats, write ? SCULL_STAT_WRITES : SCULL_STAT_READS, 1);
+    scull_stat_add(dev->stats,
+                   write ? SCULL_STAT_WRITE_BYTES : SCULL_STAT_READ_BYTES, done);
+    return done ? done : ret;
+}
+
+long scull_batch(struct file *filp, struct scull_batch *b) {
+    struct scull_dev *dev = filp->private_data;
+    struct scull_io __user *uios = u64_to_user_ptr(b->ios);
+    struct scull_io *ios, **order;
+    long retval;
+    u32 i;
+
+    // pad 留给以后的标志，现在必须为 0
+    if (b->pad) return -EINVAL;
+    if (!b->nr) return 0;
+    if (b->nr > SCULL_BATCH_MAX) return -EINVAL;
+    ios = kvmalloc_array(b->nr, sizeof(*ios), GFP_KERNEL);
+    order = kvmalloc_array(b->nr, sizeof(*order), GFP_KERNEL);
+    if (!ios || !order) {
+        retval = -ENOMEM;
+        goto out;
+    }
+    if (copy_from_user(ios, uios, b->nr * sizeof(*ios))) {
+        retval = -EFAULT;
+        goto out;
+    }
+    for (i = 0; i < b->nr; i++) {
+        order[i] = ios + i;
+        // 因为信号没有执行的项
+        ios[i].result = -EINTR;
+    }
+    sort(order, b->nr, sizeof(*order), scull_io_cmp, NULL);
+
+    if (down_interruptible(&dev->sem)) {
+        retval = -ERESTARTSYS;
+        goto out;
+    }
+    for (i = 0; i < b->nr; i++) {
+        if (fatal_signal_pending(current)) break;
+        order[i]->result = scull_io_one(filp, order[i]);
+    }
+    up(&dev->sem);
+
+    retval = i;
+    if (copy_to_user(uios, ios, b->nr * sizeof(*ios))) retval = -EFAULT;
+out:
+    kvfree(order);
+    kvfree(ios);
+    return retval;
+}
@@ -0,0 +1,229 @@
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/shrinker.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#include "scull.h"
+
+// 缓存模式
+// 打开缓存模式的设备上，每个量子的元数据链接到设备的 LRU 链表，每次读写把量子移到链表末尾，
+// 链表头就是最久没有访问的量子，维护的开销是常数时间。
+// 超过 cache_ttl 没有访问的量子过期：读到时立即淘汰，后台工作定期从链表头开始清理；
+// LRU 链表中的量子占用的内存超过 cache_budget 时，从链表头开始淘汰，写入时也会先腾出空间。
+// 内存紧张时 shrinker 同样从链表头开始回收。
+// 被淘汰的位置变成空洞，缓存模式下读到空洞返回 -ENODATA，表示没有命中。
+// 等待写回后备文件的脏量子不会被淘汰；键值存储的值不在 LRU 链表中，不计入预算
+
+// 所有打开了缓存模式的设备，供 shrinker 使用
+static LIST_HEAD(scull_cache_devs);
+static DEFINE_SPINLOCK(scull_cache_lock);
+
+// 读写访问了一个量子，调用者持有互斥锁
+void scull_cache_touch(struct scull_dev *dev, struct scull_qset *dptr, int i) {
+    struct scull_qmeta *m = &dptr->meta[i];
+
+    if (!m->lru.next) {
+        m->qs = dptr;
+        list_add_tail(&m->lru, &dev->lru);
+        dev->cache_nr++;
+    } else {
+        list_move_tail(&m->lru, &dev->lru);
+    }
+}
+
+static bool scull_cache_stale(struct scull_dev *dev, struct scull_qmeta *m) {
+    return dev->cache_ttl &&
+           time_after(jiffies, m->atime + msecs_to_jiffies(dev->cache_ttl));
+}
+
+// 量子能否淘汰：脏量子还没有写回，不能丢弃；内存回收时不处理共享的量子，
+// 释放共享的量子需要去重的全局锁，持有这把锁的路径可能正在分配内存
+static bool scull_cache_evictable(struct scull_qmeta *m, bool reclaim) {
+    return !(m->flags & SCULL_Q_DIRTY) && !(reclaim && m->shared);
+}
+
+// 淘汰一个量子，scull_qfree 负责把它从 LRU 链表中删除
+static void scull_cache_drop(struct scull_dev *dev, struct scull_qmeta *m,
+                             int item) {
+    struct scull_qset *qs = m->qs;
+
+    scull_qfree(dev, qs, m - qs->meta);
+    scull_stat_add(dev->stats, item, 1);
+}
+
+// 读取前检查量子是否过期，过期的量子立即淘汰，返回真。调用者持有互斥锁
+bool scull_cache_expire(struct scull_dev *dev, struct scull_qset *dptr, int i) {
+    struct scull_qmeta *m = &dptr->meta[i];
+
+    if (!scull_cache_stale(dev, m) || !scull_cache_evictable(m, false))
+        return false;
+    scull_cache_drop(dev, m, SCULL_STAT_CACHE_EXPIRE);
+    return true;
+}
+
+// 淘汰链表头的过期量子，调用者持有互斥锁
+static void scull_cache_expire_all(struct scull_dev *dev) {
+    struct scull_qmeta *m, *n;
+
+    list_for_each_entry_safe(m, n, &dev->lru, lru) {
+        // 链表按访问时间排列，遇到没有过期的就可以停止
+        if (!scull_cache_stale(dev, m)) break;
+        if (scull_cache_evictable(m, false))
+            scull_cache_drop(dev, m, SCULL_STAT_CACHE_EXPIRE);
+    }
+}
+
+// LRU 链表中的量子占用的内存。allocated 还包括键值存储的量子，不能用来和预算比较
+static unsigned long scull_cache_bytes(struct scull_dev *dev) {
+    return dev->cache_nr * dev->quantum;
+}
+
+// 从最久没有访问的量子开始淘汰，直到链表中的量子占用的内存不超过 target，或者检查了 nr 个量子
+// 返回淘汰的数量，调用者持有互斥锁
+static unsigned long scull_cache_evict(struct scull_dev *dev,
+                                       unsigned long target, unsigned long nr,
+                                       bool reclaim) {
+    struct scull_qmeta *m, *n;
+    unsigned long freed = 0;
+
+    list_for_each_entry_safe(m, n, &dev->lru, lru) {
+        if (scull_cache_bytes(dev) <= target || !nr--) break;
+        if (!scull_cache_evictable(m, reclaim)) continue;
+        scull_cache_drop(dev, m, SCULL_STAT_CACHE_EVICT);
+        freed++;
+    }
+    return freed;
+}
+
+// 写入需要分配新量子之前调用，超出预算时先腾出一个量子的空间。调用者持有互斥锁
+void scull_cache_make_room(struct scull_dev *dev) {
+    if (!dev->cache_budget) return;
+    if (dev->cache_budget < dev->quantum)
+        scull_cache_evict(dev, 0, ULONG_MAX, false);
+    else
+        scull_cache_evict(dev, dev->cache_budget - dev->quantum, ULONG_MAX,
+                          false);
+}
+
+// 后台工作的周期：不超过 1 秒，过期时间更短时按过期时间的一半
+static unsigned long scull_cache_period(struct scull_dev *dev) {
+    unsigned int ms = 1000;
+
+    if (dev->cache_ttl) ms = clamp(dev->cache_ttl / 2, 10U, ms);
+    return msecs_to_jiffies(ms);
+}
+
+static void scull_cache_work_fn(struct work_struct *work) {
+    struct scull_dev *dev =
+        container_of(to_delayed_work(work), struct scull_dev, cache_work);
+
+    down(&dev->sem);
+    if (dev->cache) {
+        scull_cache_expire_all(dev);
+        if (dev->cache_budget)
+            scull_cache_evict(dev, dev->cache_budget, ULONG_MAX, false);
+        schedule_delayed_work(&dev->cache_work, scull_cache_period(dev));
+    }
+    up(&dev->sem);
+}
+
+// SCULL_IOCSCACHE
+int scull_cache_set(struct scull_dev *dev, struct scull_cache *c) {
+    bool on = c->flags & SCULL_CACHE_ON;
+    int retval = 0;
+
+    if (c->flags & ~SCULL_CACHE_ON) return -EINVAL;
+    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+    if (on != dev->cache) {
+        // 已有的量子不在 LRU 链表中，切换模式只能在设备为空时进行
+        if (dev->size) {
+            retval = -EBUSY;
+            goto out;
+        }
+        spin_lock(&scull_cache_lock);
+        if (on)
+            list_add(&dev->cache_node, &scull_cache_devs);
+        else
+            list_del(&dev->cache_node);
+        spin_unlock(&scull_cache_lock);
+        dev->cache = on;
+    }
+    dev->cache_ttl = c->ttl_ms;
+    dev->cache_budget = c->budget;
+    // 按新的参数尽快清理一次
+    if (on) mod_delayed_work(system_wq, &dev->cache_work, 0);
+out:
+    up(&dev->sem);
+    return retval;
+}
+
+// SCULL_IOCGCACHE
+void scull_cache_get(struct scull_dev *dev, struct scull_cache *c) {
+    c->flags = dev->cache ? SCULL_CACHE_ON : 0;
+    c->ttl_ms = dev->cache_ttl;
+    c->budget = dev->cache_budget;
+}
+
+// 初始化设备的缓存模式相关字段
+void scull_cache_setup(struct scull_dev *dev) {
+    INIT_LIST_HEAD(&dev->lru);
+    INIT_DELAYED_WORK(&dev->cache_work, scull_cache_work_fn);
+}
+
+// 释放设备之前调用，设备已经没有用户
+void scull_cache_release(struct scull_dev *dev) {
+    if (dev->cache) {
+        spin_lock(&scull_cache_lock);
+        list_del(&dev->cache_node);
+        spin_unlock(&scull_cache_lock);
+        dev->cache = false;
+    }
+    cancel_delayed_work_sync(&dev->cache_work);
+}
+
+// 内存回收
+// 缓存的内容本来就可以丢弃，内存紧张时从 LRU 链表头开始回收，计入淘汰计数
+
+static unsigned long scull_cache_shrink_count(struct shrinker *shrink,
+                                              struct shrink_control *sc) {
+    struct scull_dev *dev;
+    unsigned long count = 0;
+
+    spin_lock(&scull_cache_lock);
+    list_for_each_entry(dev, &scull_cache_devs, cache_node)
+        count += READ_ONCE(dev->cache_nr);
+    spin_unlock(&scull_cache_lock);
+    return count ? count : SHRINK_EMPTY;
+}
+
+static unsigned long scull_cache_shrink_scan(struct shrinker *shrink,
+                                             struct shrink_control *sc) {
+    struct scull_dev *dev;
+    unsigned long freed = 0;
+
+    spin_lock(&scull_cache_lock);
+    list_for_each_entry(dev, &scull_cache_devs, cache_node) {
+        if (freed >= sc->nr_to_scan) break;
+        // 和管道的 shrinker 一样，不能等待互斥锁
+        if (down_trylock(&dev->sem)) continue;
+        freed += scull_cache_evict(dev, 0, sc->nr_to_scan - freed, true);
+        up(&dev->sem);
+    }
+    spin_unlock(&scull_cache_lock);
+    return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker scull_cache_shrinker = {
+    .count_objects = scull_cache_shrink_count,
+    .scan_objects = scull_cache_shrink_scan,
+    .seeks = DEFAULT_SEEKS,
+};
+
+void scull_cache_init(void) {
+    if (register_shrinker(&scull_cache_shrinker))
+        printk(KERN_NOTICE "Unable to register scull cache shrinker\n");
+}
+
+void scull_cache_exit(void) { unregister_shrinker(&scull_cache_shrinker); }
@@ -0,0 +1,124 @@
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/lz4.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#include "scull.h"
+
+// 冷量子压缩
+// 开启了压缩的设备上，超过 compress_ms 毫秒没有被访问的量子由后台工作压缩成 LZ4 格式：
+// data[i] 改为指向压缩后的数据，meta[i].zlen 记录压缩后的长度。
+// 读写访问到被压缩的量子时先调用 scull_zload 解压，恢复成普通的量子。
+// 需要内核提供 lz4_compress 和 lz4_decompress（CONFIG_LZ4_COMPRESS、CONFIG_LZ4_DECOMPRESS）
+
+static void scull_zwork_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(scull_zwork, scull_zwork_fn);
+
+// LZ4 压缩需要的工作内存，后台工作不会并发执行，所有设备共用一份
+static void *scull_zwrkmem;
+
+// 压缩一个设备上的冷量子，调用者持有互斥锁
+static void scull_zscan(struct scull_dev *dev, unsigned long age) {
+    struct scull_qset *dptr;
+    struct scull_qmeta *m;
+    int i, len, bound = LZ4_compressBound(dev->quantum);
+    void *dst, *z;
+
+    dst = kvmalloc(bound, GFP_KERNEL);
+    if (!dst) return;
+
+    for (dptr = dev->data; dptr; dptr = dptr->next) {
+        if (!dptr->data) continue;
+        for (i = 0; i < dev->qset; i++) {
+            m = &dptr->meta[i];
+            // 共享的量子可能被多个设备引用，脏量子等待写回，都不压缩
+            if (!dptr->data[i] || m->zlen || m->shared ||
+                (m->flags & (SCULL_Q_INCOMPRESSIBLE | SCULL_Q_DIRTY)) ||
+                time_before(jiffies, m->atime + age))
+                continue;
+            len = LZ4_compress_default(dptr->data[i], dst, dev->quantum, bound,
+                                       scull_zwrkmem);
+            // 至少省下四分之一的空间才值得，否则解压的开销得不偿失
+            if (len <= 0 || len > dev->quantum - dev->quantum / 4) {
+                m->flags |= SCULL_Q_INCOMPRESSIBLE;
+                continue;
+            }
+            z = kmalloc(len, GFP_KERNEL_ACCOUNT);
+            if (!z) goto out;
+            memcpy(z, dst, len);
+            kfree(dptr->data[i]);
+            dptr->data[i] = z;
+            m->zlen = len;
+            scull_stat_add(dev->stats, SCULL_STAT_COMPRESS, 1);
+        }
+        cond_resched();
+    }
+out:
+    kvfree(dst);
+}
+
+// 后台工作：依次处理开启了压缩的设备，按最短的压缩时间重新调度自己
+static void scull_zwork_fn(struct work_struct *work) {
+    struct scull_dev *dev;
+    unsigned int ms, next = 0;
+    int i;
+
+    for (i = 0; i < scull_nr_devs; i++) {
+        dev = scull_devices + i;
+        ms = READ_ONCE(dev->compress_ms);
+        if (!ms) continue;
+        next = next ? min(next, ms) : ms;
+        // 设备正在被使用，说明数据不冷，等下一轮
+        if (down_trylock(&dev->sem)) continue;
+        scull_zscan(dev, msecs_to_jiffies(ms));
+        up(&dev->sem);
+    }
+    if (next) schedule_delayed_work(&scull_zwork, msecs_to_jiffies(next));
+}
+
+// 访问量子之前调用，确保量子没有被压缩，并更新访问时间。调用者持有互斥锁
+int scull_zload(struct scull_dev *dev, struct scull_qset *dptr, int i) {
+    struct scull_qmeta *m = &dptr->meta[i];
+    u64 start;
+    void *q;
+
+    m->atime = jiffies;
+    if (!m->zlen) return 0;
+
+    start = local_clock();
+    q = kmalloc(dev->quantum, GFP_KERNEL_ACCOUNT);
+    if (!q) return -ENOMEM;
+    if (LZ4_decompress_safe(dptr->data[i], q, m->zlen, dev->quantum) !=
+        dev->quantum) {
+        kfree(q);
+        return -EIO;
+    }
+    kfree(dptr->data[i]);
+    dptr->data[i] = q;
+    m->zlen = 0;
+    scull_stat_add(dev->stats, SCULL_STAT_DECOMPRESS, 1);
+    scull_stat_time(dev->stats, SCULL_HIST_DECOMPRESS, local_clock() - start);
+    return 0;
+}
+
+// 设置设备的压缩时间，0 表示关闭。关闭后已经压缩的量子保持压缩，访问时再解压
+void scull_zset(struct scull_dev *dev, unsigned int ms) {
+    WRITE_ONCE(dev->compress_ms, ms);
+    if (ms) mod_delayed_work(system_wq, &scull_zwork, msecs_to_jiffies(ms));
+}
+
+int scull_zinit(void) {
+    scull_zwrkmem = vmalloc(LZ4_MEM_COMPRESS);
+    return scull_zwrkmem ? 0 : -ENOMEM;
+}
+
+// 必须在释放设备之前调用
+void scull_zcleanup(void) {
+    cancel_delayed_work_sync(&scull_zwork);
+    vfree(scull_zwrkmem);
+    scull_zwrkmem = NULL;
+}
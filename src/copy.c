@@ -0,0 +1,183 @@
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+
+#include "scull.h"
+
+// 设备之间的拷贝
+// 2 个设备的量子大小相同、拷贝的位置都在量子边界上时，目标直接引用源量子的内容（借用去重的共享机制），
+// 之后任何一方写入都会先复制一份（见 scull_unshare）。其他情况经过一个量子大小的内核缓冲区复制，
+// 数据不经过用户空间。
+// 5.4 的 copy_file_range 只接受普通文件，所以通过 ioctl 提供
+
+// 按地址顺序获取两个设备的锁，避免两个方向同时拷贝时死锁
+static int scull_lock_two(struct scull_dev *a, struct scull_dev *b) {
+    if (a > b) swap(a, b);
+    if (down_interruptible(&a->sem)) return -ERESTARTSYS;
+    if (a != b && down_interruptible(&b->sem)) {
+        up(&a->sem);
+        return -ERESTARTSYS;
+    }
+    return 0;
+}
+
+static void scull_unlock_two(struct scull_dev *a, struct scull_dev *b) {
+    if (a != b) up(&b->sem);
+    up(&a->sem);
+}
+
+// 让目标的一个整量子引用源量子的内容，调用者持有两个设备的锁
+// 返回 -EAGAIN 表示源量子无法共享，由调用者改为复制
+static int scull_copy_share(struct scull_dev *src, loff_t spos,
+                            struct scull_dev *dst, loff_t dpos) {
+    struct scull_qset *sq, *dq;
+    struct scull_shared *sh = NULL;
+    int si, di, err;
+
+    sq = scull_locate(src, spos, &si);
+    dq = sq ? scull_locate(dst, dpos, &di) : NULL;
+    if (!dq) return -ENOMEM;
+
+    if (sq->data[si]) {
+        // 源量子可能被压缩，先解压；还不是共享的量子先登记为共享
+        err = scull_zload(src, sq, si);
+        if (err) return err;
+        if (!sq->meta[si].shared) scull_dedup(src, sq, si);
+        sh = sq->meta[si].shared;
+        if (!sh) return -EAGAIN;
+        // 已经引用了同一份内容
+        if (dq->meta[di].shared == sh) goto out;
+    }
+
+    // 先检查内存上限，失败时目标原有的数据保持不变；
+    // 替换已有的量子不增加占用的内存
+    if (sh && !dq->data[di] && dst->limit &&
+        dst->allocated + dst->quantum > dst->limit)
+        return -ENOSPC;
+    if (dq->data[di])
+        scull_qfree(dst, dq, di);
+    if (sh) {
+        scull_shared_get(sh);
+        dq->data[di] = sh->data;
+        dq->meta[di].shared = sh;
+        dq->meta[di].atime = jiffies;
+        dst->allocated += dst->quantum;
+        if (dst->cache) scull_cache_touch(dst, dq, di);
+    }
+out:
+    if (dst->backing) scull_wb_dirty(dst, &dq->meta[di]);
+    scull_stat_add(dst->stats, SCULL_STAT_REMAP, 1);
+    return 0;
+}
+
+// 经过内核缓冲区复制一段数据，长度不超过源的一个量子，调用者持有两个设备的锁
+static ssize_t scull_copy_bounce(struct scull_dev *src, loff_t spos,
+                                 struct scull_dev *dst, loff_t dpos, size_t n,
+                                 void *buf) {
+    struct iov_iter iter;
+    struct kvec kv = {.iov_base = buf, .iov_len = n};
+    ssize_t ret;
+
+    iov_iter_kvec(&iter, READ, &kv, 1, n);
+    ret = scull_read_locked(src, spos, &iter);
+    if (ret <= 0) return ret;
+    n = ret;
+    kv.iov_len = n;
+    iov_iter_kvec(&iter, WRITE, &kv, 1, n);
+    // 源和目标的量子边界可能不同，分几次写入
+    while (iov_iter_count(&iter)) {
+        ret = scull_write_locked(dst, dpos, &iter);
+        if (ret < 0) return ret;
+        dpos += ret;
+    }
+    return n;
+}
+
+// 在目标设备的文件上执行 SCULL_IOCCOPY，返回拷贝的字节数
+// 中途出错时返回已经拷贝的字节数，一个字节都没有拷贝时返回错误
+long scull_copy(struct file *filp, struct scull_copy *c) {
+    struct scull_dev *dst = filp->private_data, *src;
+    loff_t spos = c->src_off, dpos = c->dst_off;
+    bool aligned, remap = c->flags & SCULL_COPY_REMAP;
+    size_t len, n, copied = 0;
+    struct file *sf;
+    ssize_t ret = 0;
+    void *buf = NULL;
+    int quantum;
+
+    if (c->flags & ~SCULL_COPY_REMAP) return -EINVAL;
+    if ((loff_t)c->src_off < 0 || (loff_t)c->dst_off < 0) return -EINVAL;
+    if (!(filp->f_mode & FMODE_WRITE)) return -EBADF;
+    sf = fget(c->src_fd);
+    if (!sf) return -EBADF;
+    if (!scull_is_dev(sf)) {
+        ret = -EINVAL;
+        goto out_put;
+    }
+    if (!(sf->f_mode & FMODE_READ)) {
+        ret = -EBADF;
+        goto out_put;
+    }
+    src = sf->private_data;
+    // 同一个设备内拷贝时范围不能重叠
+    if (src == dst && c->src_off < c->dst_off + c->len &&
+        c->dst_off < c->src_off + c->len) {
+        ret = -EINVAL;
+        goto out_put;
+    }
+
+    ret = scull_lock_two(src, dst);
+    if (ret) goto out_put;
+    quantum = src->quantum;
+    if (spos >= src->size) goto out;
+    len = min_t(u64, c->len, src->size - spos);
+    aligned = quantum == dst->quantum && (long)spos % quantum == 0 &&
+              (long)dpos % quantum == 0;
+    if (remap && (!aligned || (len % quantum && len != src->size - spos))) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    while (copied < len) {
+        if (fatal_signal_pending(current)) {
+            ret = -EINTR;
+            break;
+        }
+        // 每次处理源的一个量子以内的数据
+        n = min_t(size_t, len - copied, quantum - (long)spos % quantum);
+        ret = -EAGAIN;
+        // 不满的量子只在两边都是数据末尾时共享：量子中超出数据末尾的部分总是零，
+        // 共享之后不会在目标中多出数据
+        if (aligned && (n == quantum || (spos + n == src->size &&
+                                         dpos + n >= dst->size))) {
+            ret = scull_copy_share(src, spos, dst, dpos);
+            if (!ret && dst->size < dpos + n) dst->size = dpos + n;
+        }
+        if (ret == -EAGAIN) {
+            if (!buf) buf = kmalloc(quantum, GFP_KERNEL);
+            if (!buf) {
+                ret = -ENOMEM;
+                break;
+            }
+            ret = scull_copy_bounce(src, spos, dst, dpos, n, buf);
+            if (ret <= 0) break;
+            n = ret;
+            ret = 0;
+        }
+        if (ret) break;
+        copied += n;
+        spos += n;
+        dpos += n;
+        cond_resched();
+    }
+out:
+    scull_unlock_two(src, dst);
+    kfree(buf);
+out_put:
+    fput(sf);
+    return copied ? copied : ret;
+}
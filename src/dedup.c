@@ -0,0 +1,124 @@
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "scull.h"
+
+// 量子去重
+// 打开了去重的设备上，每次写满一个量子后计算它的哈希值，在全局哈希表中查找内容相同的量子，
+// 找到了就释放自己的内存，改为引用共享的内容；没有找到就把自己登记为共享的内容，供之后的量子使用。
+// 共享的内容不会被修改，写入之前由 scull_unshare 复制出私有的一份（写时复制）。
+// 所有设备共用一个哈希表，不同设备之间的相同内容也可以共享
+
+static DEFINE_HASHTABLE(scull_dedup_table, 10);
+// 保护哈希表和所有 scull_shared 的引用计数
+static DEFINE_MUTEX(scull_dedup_lock);
+// 共享内容的数量和引用它们的量子数量，两者之差就是省下的量子数量
+static unsigned long scull_dedup_buffers, scull_dedup_refs;
+
+// 查找内容相同的共享量子，调用者持有 scull_dedup_lock
+static struct scull_shared *scull_dedup_find(const void *data, int len,
+                                             u32 hash) {
+    struct scull_shared *sh;
+
+    hash_for_each_possible(scull_dedup_table, sh, node, hash)
+        if (sh->hash == hash && sh->len == len && !memcmp(sh->data, data, len))
+            return sh;
+    return NULL;
+}
+
+// 尝试共享刚刚写满的量子，调用者持有设备的互斥锁，量子是私有的并且没有被压缩
+// 只是一种优化，内存不足时保持私有
+void scull_dedup(struct scull_dev *dev, struct scull_qset *dptr, int i) {
+    struct scull_qmeta *m = &dptr->meta[i];
+    struct scull_shared *sh;
+    u32 hash = jhash(dptr->data[i], dev->quantum, 0);
+
+    mutex_lock(&scull_dedup_lock);
+    sh = scull_dedup_find(dptr->data[i], dev->quantum, hash);
+    if (sh) {
+        // 内容相同，释放自己的内存，引用共享的内容
+        sh->ref++;
+        kfree(dptr->data[i]);
+        dptr->data[i] = sh->data;
+        scull_stat_add(dev->stats, SCULL_STAT_DEDUP, 1);
+    } else {
+        // 登记为共享的内容，内存的所有权交给描述符
+        sh = kmalloc(sizeof(*sh), GFP_KERNEL_ACCOUNT);
+        if (!sh) goto out;
+        sh->ref = 1;
+        sh->hash = hash;
+        sh->len = dev->quantum;
+        sh->data = dptr->data[i];
+        hash_add(scull_dedup_table, &sh->node, hash);
+        scull_dedup_buffers++;
+    }
+    m->shared = sh;
+    scull_dedup_refs++;
+out:
+    mutex_unlock(&scull_dedup_lock);
+}
+
+// 释放一个引用，最后一个引用释放共享的内容
+static void __scull_shared_put(struct scull_shared *sh) {
+    scull_dedup_refs--;
+    if (--sh->ref) return;
+    hash_del(&sh->node);
+    scull_dedup_buffers--;
+    kfree(sh->data);
+    kfree(sh);
+}
+
+// 增加一个引用，调用者已经通过某个量子引用了 sh
+void scull_shared_get(struct scull_shared *sh) {
+    mutex_lock(&scull_dedup_lock);
+    sh->ref++;
+    scull_dedup_refs++;
+    mutex_unlock(&scull_dedup_lock);
+}
+
+void scull_shared_put(struct scull_shared *sh) {
+    mutex_lock(&scull_dedup_lock);
+    __scull_shared_put(sh);
+    mutex_unlock(&scull_dedup_lock);
+}
+
+// 写入共享量子之前调用，把量子变回私有的。调用者持有设备的互斥锁
+// 只有自己引用时直接收回内存，否则复制一份
+int scull_unshare(struct scull_dev *dev, struct scull_qset *dptr, int i) {
+    struct scull_qmeta *m = &dptr->meta[i];
+    struct scull_shared *sh = m->shared;
+    void *q;
+
+    mutex_lock(&scull_dedup_lock);
+    if (sh->ref == 1) {
+        hash_del(&sh->node);
+        scull_dedup_buffers--;
+        scull_dedup_refs--;
+        kfree(sh);
+    } else {
+        q = kmalloc(sh->len, GFP_KERNEL_ACCOUNT);
+        if (!q) {
+            mutex_unlock(&scull_dedup_lock);
+            return -ENOMEM;
+        }
+        memcpy(q, sh->data, sh->len);
+        dptr->data[i] = q;
+        __scull_shared_put(sh);
+        scull_stat_add(dev->stats, SCULL_STAT_COW, 1);
+    }
+    mutex_unlock(&scull_dedup_lock);
+    m->shared = NULL;
+    return 0;
+}
+
+// 报告去重的效果：共享内容的数量和引用它们的量子数量
+void scull_dedup_summary(unsigned long *buffers, unsigned long *refs) {
+    mutex_lock(&scull_dedup_lock);
+    *buffers = scull_dedup_buffers;
+    *refs = scull_dedup_refs;
+    mutex_unlock(&scull_dedup_lock);
+}
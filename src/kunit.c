@@ -0,0 +1,602 @@
+#include <kunit/test.h>
+#include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+
+#include "scull.h"
+
+// KUnit 测试
+// 不经过 /dev 下的设备文件，直接在测试自己创建的设备上调用驱动的函数：
+// scull：   量子定位和读写在量子、量子集合边界上的计算，空洞和释放
+// scullpipe：环形缓冲区的空、满和绕回
+// scull_stress：在内核中计时的压力测试，用 kunit_info 输出每个操作的平均和最大耗时，
+//              用来快速比较性能改动前后的结果
+// 用 scripts/kunit.sh 在 QEMU 中运行，见 kunit/ 目录
+
+extern struct file_operations scull_pipe_fops;
+
+struct scull_test {
+    struct scull_dev *dev;
+    struct scull_pipe *pipe;
+    struct file *filp;  // 以非阻塞读写方式打开的管道
+    struct inode inode;
+    int saved_buffer;   // 测试修改了 scull_p_buffer，结束时恢复
+};
+
+// 创建测试用的设备，和 access.c 的 scull_priv_alloc 相同，只是量子参数由测试指定
+static struct scull_dev *scull_test_dev(struct kunit *test, int quantum,
+                                        int qset) {
+    struct scull_dev *dev = kunit_kzalloc(test, sizeof(*dev), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dev);
+    dev->quantum = quantum;
+    dev->qset = qset;
+    dev->stats = alloc_percpu(struct scull_stats);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dev->stats);
+    sema_init(&dev->sem, 1);
+    scull_wb_init(dev);
+    scull_cache_setup(dev);
+    return dev;
+}
+
+static void scull_test_dev_free(struct scull_dev *dev) {
+    scull_cache_release(dev);
+    scull_wb_cleanup(dev);
+    scull_trim(dev);
+    scull_kv_clear(dev);
+    free_percpu(dev->stats);
+}
+
+// 创建测试用的管道并打开，初始化和 scull_p_init 相同，缓冲区大小为 bufsize
+static void scull_test_pipe(struct kunit *test, struct scull_test *t,
+                            int bufsize) {
+    struct scull_pipe *dev = kunit_kzalloc(test, sizeof(*dev), GFP_KERNEL);
+    struct file *filp = kunit_kzalloc(test, sizeof(*filp), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dev);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, filp);
+    dev->stats = alloc_percpu(struct scull_stats);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dev->stats);
+    init_waitqueue_head(&dev->inq);
+    init_waitqueue_head(&dev->outq);
+    INIT_LIST_HEAD(&dev->handoffs);
+    INIT_LIST_HEAD(&dev->readers);
+    sema_init(&dev->sem, 1);
+    dev->rcvlowat = dev->sndlowat = 1;
+    cdev_init(&dev->cdev, &scull_pipe_fops);
+    t->pipe = dev;
+
+    // 第一个打开者按 scull_p_buffer 分配缓冲区
+    t->saved_buffer = scull_p_buffer;
+    scull_p_buffer = bufsize;
+    t->inode.i_cdev = &dev->cdev;
+    spin_lock_init(&filp->f_lock);
+    filp->f_op = &scull_pipe_fops;
+    filp->f_flags = O_RDWR | O_NONBLOCK;
+    filp->f_mode = FMODE_READ | FMODE_WRITE;
+    KUNIT_ASSERT_EQ(test, scull_p_open(&t->inode, filp), 0);
+    t->filp = filp;
+}
+
+static void scull_test_exit(struct kunit *test) {
+    struct scull_test *t = test->priv;
+
+    if (t->dev) scull_test_dev_free(t->dev);
+    if (t->pipe) {
+        if (t->filp) scull_p_release(&t->inode, t->filp);
+        scull_p_buffer = t->saved_buffer;
+        free_percpu(t->pipe->stats);
+    }
+}
+
+// 读写一段内核缓冲区，和 copy.c 一样用 kvec 迭代器调用驱动
+
+static ssize_t scull_test_write(struct scull_dev *dev, loff_t pos,
+                                const void *buf, size_t len) {
+    struct kvec kv = {.iov_base = (void *)buf, .iov_len = len};
+    struct iov_iter iter;
+    ssize_t ret;
+
+    iov_iter_kvec(&iter, WRITE, &kv, 1, len);
+    down(&dev->sem);
+    ret = scull_write_locked(dev, pos, &iter);
+    up(&dev->sem);
+    return ret;
+}
+
+static ssize_t scull_test_read(struct scull_dev *dev, loff_t pos, void *buf,
+                               size_t len) {
+    struct kvec kv = {.iov_base = buf, .iov_len = len};
+    struct iov_iter iter;
+    ssize_t ret;
+
+    iov_iter_kvec(&iter, READ, &kv, 1, len);
+    down(&dev->sem);
+    ret = scull_read_locked(dev, pos, &iter);
+    up(&dev->sem);
+    return ret;
+}
+
+static ssize_t scull_test_pipe_io(struct file *filp, void *buf, size_t len,
+                                  bool write) {
+    struct kvec kv = {.iov_base = buf, .iov_len = len};
+    struct iov_iter iter;
+    struct kiocb kiocb;
+
+    init_sync_kiocb(&kiocb, filp);
+    iov_iter_kvec(&iter, write ? WRITE : READ, &kv, 1, len);
+    return write ? scull_p_write_iter(&kiocb, &iter)
+                 : scull_p_read_iter(&kiocb, &iter);
+}
+
+// 填充 pos 处应有的内容，第 i 个字节是 i + 1 的低 8 位（避开全零）
+static void scull_test_pattern(u8 *buf, loff_t pos, size_t len) {
+    size_t i;
+
+    for (i = 0; i < len; i++) buf[i] = (pos + i) % 255 + 1;
+}
+
+// scull：量子 8 字节，每个量子集合 4 个量子，一个量子集合保存 32 字节
+#define T_QUANTUM 8
+#define T_QSET 4
+
+static int scull_test_init(struct kunit *test) {
+    struct scull_test *t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t);
+    test->priv = t;
+    t->dev = scull_test_dev(test, T_QUANTUM, T_QSET);
+    return 0;
+}
+
+// 定位量子集合：按需分配，游标之后的位置从游标继续，之前的位置从链表头开始
+static void scull_test_follow(struct kunit *test) {
+    struct scull_dev *dev = ((struct scull_test *)test->priv)->dev;
+    struct scull_qset *qs, *walk;
+    int i;
+
+    qs = scull_follow(dev, 0);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, qs);
+    KUNIT_EXPECT_PTR_EQ(test, qs, dev->data);
+
+    qs = scull_follow(dev, 5);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, qs);
+    for (walk = dev->data, i = 0; i < 5; i++) walk = walk->next;
+    KUNIT_EXPECT_PTR_EQ(test, qs, walk);
+    KUNIT_EXPECT_PTR_EQ(test, dev->cur, walk);
+    KUNIT_EXPECT_EQ(test, dev->cur_item, 5);
+    KUNIT_EXPECT_PTR_EQ(test, walk->next, (struct scull_qset *)NULL);
+
+    // 游标之前的位置
+    qs = scull_follow(dev, 2);
+    KUNIT_EXPECT_PTR_EQ(test, qs, dev->data->next->next);
+    KUNIT_EXPECT_EQ(test, dev->cur_item, 2);
+    // 从游标继续，不分配新的量子集合
+    KUNIT_EXPECT_PTR_EQ(test, scull_follow(dev, 5), walk);
+    KUNIT_EXPECT_PTR_EQ(test, scull_follow(dev, 5), walk);
+}
+
+// 每次写入最多写到量子末尾
+static void scull_test_write_edges(struct kunit *test) {
+    struct scull_dev *dev = ((struct scull_test *)test->priv)->dev;
+    static const struct {
+        loff_t pos;
+        size_t len;
+        ssize_t expect;
+    } cases[] = {
+        {0, 3, 3},    // 量子内部
+        {5, 10, 3},   // 跨越量子边界，截断到量子末尾
+        {8, 8, 8},    // 正好一个量子
+        {30, 10, 2},  // 跨越量子集合边界
+        {31, 1, 1},   // 量子集合的最后一个字节
+        {32, 40, 8},  // 下一个量子集合的第一个量子
+        {100, 1, 1},  // 跳过几个量子集合
+    };
+    u8 buf[64];
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(cases); i++) {
+        scull_test_pattern(buf, cases[i].pos, cases[i].len);
+        KUNIT_EXPECT_EQ_MSG(
+            test, scull_test_write(dev, cases[i].pos, buf, cases[i].len),
+            cases[i].expect, "pos %lld len %zu", cases[i].pos, cases[i].len);
+    }
+    KUNIT_EXPECT_EQ(test, dev->size, 101UL);
+    // 写入了 0-7、8-15、24-31、32-39、96-103 所在的 5 个量子
+    KUNIT_EXPECT_EQ(test, dev->allocated, 5UL * T_QUANTUM);
+}
+
+// 每次读取最多读到量子末尾和数据末尾
+static void scull_test_read_edges(struct kunit *test) {
+    struct scull_dev *dev = ((struct scull_test *)test->priv)->dev;
+    static const struct {
+        loff_t pos;
+        size_t len;
+        ssize_t expect;
+    } cases[] = {
+        {0, 100, 8},  {6, 100, 2}, {31, 5, 1},  {32, 8, 8},
+        {96, 10, 4},  {99, 10, 1}, {100, 1, 0}, {200, 1, 0},
+    };
+    u8 buf[100], expect[100];
+    loff_t pos = 0;
+    ssize_t ret;
+    int i;
+
+    // 逐段写入 100 字节
+    scull_test_pattern(buf, 0, sizeof(buf));
+    while (pos < sizeof(buf)) {
+        ret = scull_test_write(dev, pos, buf + pos, sizeof(buf) - pos);
+        KUNIT_ASSERT_GT(test, ret, (ssize_t)0);
+        pos += ret;
+    }
+    KUNIT_ASSERT_EQ(test, dev->size, 100UL);
+
+    for (i = 0; i < ARRAY_SIZE(cases); i++) {
+        ret = scull_test_read(dev, cases[i].pos, buf, cases[i].len);
+        KUNIT_EXPECT_EQ_MSG(test, ret, cases[i].expect, "pos %lld len %zu",
+                            cases[i].pos, cases[i].len);
+        if (ret <= 0) continue;
+        scull_test_pattern(expect, cases[i].pos, ret);
+        KUNIT_EXPECT_EQ(test, memcmp(buf, expect, ret), 0);
+    }
+}
+
+// 没有写入的区域和全零的量子是空洞，读出来是零，不占内存
+static void scull_test_holes(struct kunit *test) {
+    struct scull_dev *dev = ((struct scull_test *)test->priv)->dev;
+    u8 buf[T_QUANTUM], zero[T_QUANTUM] = {0};
+
+    memset(buf, 0xaa, sizeof(buf));
+    KUNIT_ASSERT_EQ(test, scull_test_write(dev, 40, buf, 1), (ssize_t)1);
+    KUNIT_EXPECT_EQ(test, dev->size, 41UL);
+    KUNIT_EXPECT_EQ(test, dev->allocated, (unsigned long)T_QUANTUM);
+
+    KUNIT_EXPECT_EQ(test, scull_test_read(dev, 0, buf, sizeof(buf)),
+                    (ssize_t)T_QUANTUM);
+    KUNIT_EXPECT_EQ(test, memcmp(buf, zero, sizeof(buf)), 0);
+
+    // 写入全零的量子被释放
+    KUNIT_EXPECT_EQ(test, scull_test_write(dev, 48, zero, sizeof(zero)),
+                    (ssize_t)T_QUANTUM);
+    KUNIT_EXPECT_EQ(test, dev->size, 56UL);
+    KUNIT_EXPECT_EQ(test, dev->allocated, (unsigned long)T_QUANTUM);
+    memset(buf, 0xaa, sizeof(buf));
+    KUNIT_EXPECT_EQ(test, scull_test_read(dev, 48, buf, sizeof(buf)),
+                    (ssize_t)T_QUANTUM);
+    KUNIT_EXPECT_EQ(test, memcmp(buf, zero, sizeof(buf)), 0);
+
+    // 原来有数据的量子写成全零后也被释放
+    KUNIT_EXPECT_EQ(test, scull_test_write(dev, 40, zero, 1), (ssize_t)1);
+    KUNIT_EXPECT_EQ(test, dev->allocated, 0UL);
+}
+
+// 释放整个设备之后可以重新写入
+static void scull_test_trim(struct kunit *test) {
+    struct scull_dev *dev = ((struct scull_test *)test->priv)->dev;
+    u8 buf[T_QUANTUM], expect[T_QUANTUM];
+    loff_t pos;
+
+    scull_test_pattern(buf, 0, sizeof(buf));
+    for (pos = 0; pos < 10 * T_QSET * T_QUANTUM; pos += T_QUANTUM)
+        KUNIT_ASSERT_EQ(test, scull_test_write(dev, pos, buf, sizeof(buf)),
+                        (ssize_t)T_QUANTUM);
+    KUNIT_EXPECT_EQ(test, dev->allocated, 10UL * T_QSET * T_QUANTUM);
+
+    down(&dev->sem);
+    scull_trim(dev);
+    up(&dev->sem);
+    KUNIT_EXPECT_EQ(test, dev->size, 0UL);
+    KUNIT_EXPECT_EQ(test, dev->allocated, 0UL);
+    KUNIT_EXPECT_PTR_EQ(test, dev->data, (struct scull_qset *)NULL);
+    KUNIT_EXPECT_PTR_EQ(test, dev->cur, (struct scull_qset *)NULL);
+    KUNIT_EXPECT_EQ(test, scull_test_read(dev, 0, buf, sizeof(buf)),
+                    (ssize_t)0);
+
+    // 游标已经清除，不会访问释放了的量子集合
+    scull_test_pattern(buf, 100, sizeof(buf));
+    KUNIT_EXPECT_EQ(test, scull_test_write(dev, 100, buf, 4), (ssize_t)4);
+    KUNIT_EXPECT_EQ(test, scull_test_read(dev, 100, expect, 4), (ssize_t)4);
+    KUNIT_EXPECT_EQ(test, memcmp(buf, expect, 4), 0);
+}
+
+// 超过内存上限的写入返回 -ENOSPC，已经分配的量子仍然可以写
+static void scull_test_limit(struct kunit *test) {
+    struct scull_dev *dev = ((struct scull_test *)test->priv)->dev;
+    u8 buf[T_QUANTUM];
+
+    memset(buf, 0x5a, sizeof(buf));
+    dev->limit = 2 * T_QUANTUM;
+    KUNIT_EXPECT_EQ(test, scull_test_write(dev, 0, buf, sizeof(buf)),
+                    (ssize_t)T_QUANTUM);
+    KUNIT_EXPECT_EQ(test, scull_test_write(dev, 8, buf, sizeof(buf)),
+                    (ssize_t)T_QUANTUM);
+    KUNIT_EXPECT_EQ(test, scull_test_write(dev, 16, buf, sizeof(buf)),
+                    (ssize_t)-ENOSPC);
+    KUNIT_EXPECT_EQ(test, scull_test_write(dev, 4, buf, sizeof(buf)),
+                    (ssize_t)(T_QUANTUM - 4));
+    KUNIT_EXPECT_EQ(test, dev->size, 16UL);
+}
+
+static struct kunit_case scull_test_cases[] = {
+    KUNIT_CASE(scull_test_follow),
+    KUNIT_CASE(scull_test_write_edges),
+    KUNIT_CASE(scull_test_read_edges),
+    KUNIT_CASE(scull_test_holes),
+    KUNIT_CASE(scull_test_trim),
+    KUNIT_CASE(scull_test_limit),
+    {}
+};
+
+static struct kunit_suite scull_test_suite = {
+    .name = "scull",
+    .init = scull_test_init,
+    .exit = scull_test_exit,
+    .test_cases = scull_test_cases,
+};
+
+// scullpipe：缓冲区 8 字节，最多保存 7 字节
+
+#define T_PIPE 8
+
+static int scullpipe_test_init(struct kunit *test) {
+    struct scull_test *t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t);
+    test->priv = t;
+    scull_test_pipe(test, t, T_PIPE);
+    return 0;
+}
+
+static void scullpipe_test_empty(struct kunit *test) {
+    struct file *filp = ((struct scull_test *)test->priv)->filp;
+    unsigned int mask = scull_p_poll(filp, NULL);
+    u8 buf[4];
+
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, sizeof(buf), false),
+                    (ssize_t)-EAGAIN);
+    KUNIT_EXPECT_FALSE(test, mask & POLLIN);
+    KUNIT_EXPECT_TRUE(test, mask & POLLOUT);
+}
+
+static void scullpipe_test_full(struct kunit *test) {
+    struct file *filp = ((struct scull_test *)test->priv)->filp;
+    u8 buf[20], expect[20];
+    unsigned int mask;
+
+    scull_test_pattern(buf, 0, sizeof(buf));
+    // 保留一个字节区分空和满
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, sizeof(buf), true),
+                    (ssize_t)(T_PIPE - 1));
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, 1, true),
+                    (ssize_t)-EAGAIN);
+    mask = scull_p_poll(filp, NULL);
+    KUNIT_EXPECT_TRUE(test, mask & POLLIN);
+    KUNIT_EXPECT_FALSE(test, mask & POLLOUT);
+
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, sizeof(buf), false),
+                    (ssize_t)(T_PIPE - 1));
+    scull_test_pattern(expect, 0, T_PIPE - 1);
+    KUNIT_EXPECT_EQ(test, memcmp(buf, expect, T_PIPE - 1), 0);
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, 1, false),
+                    (ssize_t)-EAGAIN);
+}
+
+// 读写指针绕回缓冲区起点
+static void scullpipe_test_wrap(struct kunit *test) {
+    struct scull_test *t = test->priv;
+    struct file *filp = t->filp;
+    u8 buf[16], expect[16];
+
+    // 读写指针都移到 5
+    scull_test_pattern(buf, 0, 5);
+    KUNIT_ASSERT_EQ(test, scull_test_pipe_io(filp, buf, 5, true), (ssize_t)5);
+    KUNIT_ASSERT_EQ(test, scull_test_pipe_io(filp, buf, 5, false), (ssize_t)5);
+    KUNIT_EXPECT_PTR_EQ(test, t->pipe->rp, t->pipe->buffer + 5);
+
+    // 一次写入只写到缓冲区末尾，写指针绕回起点
+    scull_test_pattern(buf, 5, 6);
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, 6, true), (ssize_t)3);
+    KUNIT_EXPECT_PTR_EQ(test, t->pipe->wp, t->pipe->buffer);
+    // 绕回之后写到读指针前一个字节
+    scull_test_pattern(buf, 8, 6);
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, 6, true), (ssize_t)4);
+    KUNIT_EXPECT_PTR_EQ(test, t->pipe->wp, t->pipe->buffer + 4);
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, 1, true),
+                    (ssize_t)-EAGAIN);
+
+    // 一次读取跨越缓冲区末尾，分两段复制
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(filp, buf, sizeof(buf), false),
+                    (ssize_t)(T_PIPE - 1));
+    scull_test_pattern(expect, 5, T_PIPE - 1);
+    KUNIT_EXPECT_EQ(test, memcmp(buf, expect, T_PIPE - 1), 0);
+    KUNIT_EXPECT_PTR_EQ(test, t->pipe->rp, t->pipe->wp);
+}
+
+// 读写双方都关闭后释放缓冲区，重新打开时从头开始
+static void scullpipe_test_reopen(struct kunit *test) {
+    struct scull_test *t = test->priv;
+    u8 buf[4] = {1, 2, 3, 4};
+
+    KUNIT_ASSERT_EQ(test, scull_test_pipe_io(t->filp, buf, 4, true),
+                    (ssize_t)4);
+    scull_p_release(&t->inode, t->filp);
+    KUNIT_EXPECT_PTR_EQ(test, t->pipe->buffer, (char *)NULL);
+
+    memset(t->filp, 0, sizeof(*t->filp));
+    spin_lock_init(&t->filp->f_lock);
+    t->filp->f_op = &scull_pipe_fops;
+    t->filp->f_flags = O_RDWR | O_NONBLOCK;
+    t->filp->f_mode = FMODE_READ | FMODE_WRITE;
+    KUNIT_ASSERT_EQ(test, scull_p_open(&t->inode, t->filp), 0);
+    KUNIT_EXPECT_PTR_EQ(test, t->pipe->rp, t->pipe->buffer);
+    KUNIT_EXPECT_PTR_EQ(test, t->pipe->wp, t->pipe->buffer);
+    KUNIT_EXPECT_EQ(test, scull_test_pipe_io(t->filp, buf, 4, false),
+                    (ssize_t)-EAGAIN);
+}
+
+static struct kunit_case scullpipe_test_cases[] = {
+    KUNIT_CASE(scullpipe_test_empty),
+    KUNIT_CASE(scullpipe_test_full),
+    KUNIT_CASE(scullpipe_test_wrap),
+    KUNIT_CASE(scullpipe_test_reopen),
+    {}
+};
+
+static struct kunit_suite scullpipe_test_suite = {
+    .name = "scullpipe",
+    .init = scullpipe_test_init,
+    .exit = scull_test_exit,
+    .test_cases = scullpipe_test_cases,
+};
+
+// 压力测试：在内核中计时，输出每个操作的平均和最大耗时（纳秒）
+// 结果只用于比较，不做断言，只检查操作本身是否成功
+
+struct scull_timing {
+    u64 total, max, ops;
+};
+
+static inline u64 scull_timing_start(void) { return ktime_get_ns(); }
+
+static inline void scull_timing_end(struct scull_timing *tm, u64 start) {
+    u64 ns = ktime_get_ns() - start;
+
+    tm->total += ns;
+    tm->max = max(tm->max, ns);
+    tm->ops++;
+}
+
+static void scull_timing_report(struct kunit *test, const char *name,
+                                const struct scull_timing *tm, int batch) {
+    kunit_info(test, "%s: %llu ops, avg %llu ns/op, max %llu ns\n", name,
+               tm->ops * batch, div64_u64(tm->total, tm->ops * batch),
+               tm->max);
+}
+
+#define STRESS_QSETS 4096
+#define STRESS_BATCH 64  // 单次定位只有几纳秒，每 64 次计一次时
+#define STRESS_REGION (4 << 20)
+
+static int scull_stress_init(struct kunit *test) {
+    struct scull_test *t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t);
+    test->priv = t;
+    return 0;
+}
+
+// 顺序定位可以从游标继续，随机定位平均要走半个链表
+static void scull_stress_follow(struct kunit *test) {
+    struct scull_test *t = test->priv;
+    struct scull_timing seq = {0}, rnd = {0};
+    struct scull_dev *dev;
+    int i, j;
+    u64 start;
+
+    dev = t->dev = scull_test_dev(test, T_QUANTUM, 1);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, scull_follow(dev, STRESS_QSETS - 1));
+
+    down(&dev->sem);
+    for (j = 0; j < 16 * STRESS_QSETS; j += STRESS_BATCH) {
+        start = scull_timing_start();
+        for (i = 0; i < STRESS_BATCH; i++)
+            scull_follow(dev, (j + i) % STRESS_QSETS);
+        scull_timing_end(&seq, start);
+    }
+    for (j = 0; j < 4 * STRESS_QSETS; j += STRESS_BATCH) {
+        start = scull_timing_start();
+        for (i = 0; i < STRESS_BATCH; i++)
+            scull_follow(dev, prandom_u32() % STRESS_QSETS);
+        scull_timing_end(&rnd, start);
+        cond_resched();
+    }
+    up(&dev->sem);
+    scull_timing_report(test, "follow_seq", &seq, STRESS_BATCH);
+    scull_timing_report(test, "follow_rand", &rnd, STRESS_BATCH);
+}
+
+// 默认量子大小下顺序写满、读出和释放一块区域
+static void scull_stress_rw(struct kunit *test) {
+    struct scull_test *t = test->priv;
+    struct scull_timing wr = {0}, rd = {0}, trim = {0};
+    struct scull_dev *dev;
+    loff_t pos;
+    ssize_t ret;
+    u64 start;
+    u8 *buf;
+
+    dev = t->dev = scull_test_dev(test, SCULL_QUANTUM, SCULL_QSET);
+    buf = kunit_kmalloc(test, PAGE_SIZE, GFP_KERNEL);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+    memset(buf, 0x5a, PAGE_SIZE);
+
+    for (pos = 0; pos < STRESS_REGION; pos += ret) {
+        start = scull_timing_start();
+        ret = scull_test_write(dev, pos, buf, PAGE_SIZE);
+        scull_timing_end(&wr, start);
+        KUNIT_ASSERT_GT(test, ret, (ssize_t)0);
+        cond_resched();
+    }
+    for (pos = 0; pos < STRESS_REGION; pos += ret) {
+        start = scull_timing_start();
+        ret = scull_test_read(dev, pos, buf, PAGE_SIZE);
+        scull_timing_end(&rd, start);
+        KUNIT_ASSERT_GT(test, ret, (ssize_t)0);
+        cond_resched();
+    }
+    down(&dev->sem);
+    start = scull_timing_start();
+    scull_trim(dev);
+    scull_timing_end(&trim, start);
+    up(&dev->sem);
+
+    scull_timing_report(test, "write", &wr, 1);
+    scull_timing_report(test, "read", &rd, 1);
+    scull_timing_report(test, "trim", &trim, 1);
+}
+
+// 管道交替写入和读取，块大小不整除缓冲区大小，读写指针不断绕回
+static void scull_stress_pipe(struct kunit *test) {
+    struct scull_test *t = test->priv;
+    struct scull_timing tm = {0};
+    ssize_t ret;
+    u64 start;
+    u8 *buf;
+    int i;
+
+    scull_test_pipe(test, t, SCULL_P_BUFFER);
+    buf = kunit_kzalloc(test, 1000, GFP_KERNEL);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+
+    for (i = 0; i < 100000; i++) {
+        start = scull_timing_start();
+        ret = scull_test_pipe_io(t->filp, buf, 1000, true);
+        if (ret > 0) ret = scull_test_pipe_io(t->filp, buf, ret, false);
+        scull_timing_end(&tm, start);
+        KUNIT_ASSERT_GT(test, ret, (ssize_t)0);
+        if (!(i % 1024)) cond_resched();
+    }
+    scull_timing_report(test, "pipe_wrap", &tm, 1);
+}
+
+static struct kunit_case scull_stress_cases[] = {
+    KUNIT_CASE(scull_stress_follow),
+    KUNIT_CASE(scull_stress_rw),
+    KUNIT_CASE(scull_stress_pipe),
+    {}
+};
+
+static struct kunit_suite scull_stress_suite = {
+    .name = "scull_stress",
+    .init = scull_stress_init,
+    .exit = scull_test_exit,
+    .test_cases = scull_stress_cases,
+};
+
+kunit_test_suites(&scull_test_suite, &scullpipe_test_suite,
+                  &scull_stress_suite);
@@ -0,0 +1,232 @@
+#include <linux/fs.h>
+#include <linux/jhash.h>
+#include <linux/kernel.h>
+#include <linux/overflow.h>
+#include <linux/rhashtable.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+
+#include "scull.h"
+
+// 键值存储
+// 每个设备一张可以自动扩缩的哈希表（rhashtable），一次 ioctl 完成一次查找，不需要在用户空间维护索引。
+// 值存放在从设备分配的量子中，和字节流一样计入设备的内存上限。
+// 所有操作都持有设备的互斥锁，哈希表只用来加速查找
+
+struct scull_kv_table {
+    struct rhashtable ht;
+};
+
+// 一个键值对
+struct scull_kv_entry {
+    struct rhash_head node;
+    struct rcu_head rcu;  // rhashtable 扩缩时可能还在访问，延迟释放
+    u32 klen;             // 键的长度
+    u32 vlen;             // 值的长度
+    int nq;               // 存放值的量子数量
+    void **q;             // 存放值的量子
+    char key[];
+};
+
+// 查找时使用的键
+struct scull_kv_key {
+    const char *data;
+    u32 len;
+};
+
+static u32 scull_kv_hashfn(const void *data, u32 len, u32 seed) {
+    const struct scull_kv_key *k = data;
+
+    return jhash(k->data, k->len, seed);
+}
+
+static u32 scull_kv_obj_hashfn(const void *data, u32 len, u32 seed) {
+    const struct scull_kv_entry *e = data;
+
+    return jhash(e->key, e->klen, seed);
+}
+
+static int scull_kv_obj_cmpfn(struct rhashtable_compare_arg *arg,
+                              const void *obj) {
+    const struct scull_kv_key *k = arg->key;
+    const struct scull_kv_entry *e = obj;
+
+    return e->klen != k->len || memcmp(e->key, k->data, k->len);
+}
+
+static const struct rhashtable_params scull_kv_params = {
+    .head_offset = offsetof(struct scull_kv_entry, node),
+    .hashfn = scull_kv_hashfn,
+    .obj_hashfn = scull_kv_obj_hashfn,
+    .obj_cmpfn = scull_kv_obj_cmpfn,
+    .automatic_shrinking = true,
+};
+
+// 释放键值对和存放值的量子，调用者持有互斥锁，键值对已经不在哈希表中
+static void scull_kv_free(struct scull_dev *dev, struct scull_kv_entry *e) {
+    int i;
+
+    for (i = 0; i < e->nq; i++) kfree(e->q[i]);
+    dev->allocated -= e->nq * dev->quantum;
+    kfree(e->q);
+    kfree_rcu(e, rcu);
+}
+
+static void scull_kv_free_fn(void *ptr, void *arg) {
+    scull_kv_free(arg, ptr);
+}
+
+// 创建键值对并复制值，值按量子大小分段存放
+static struct scull_kv_entry *scull_kv_alloc(struct scull_dev *dev,
+                                             const struct scull_kv_key *k,
+                                             const char __user *val, u32 vlen) {
+    int nq = DIV_ROUND_UP(vlen, dev->quantum), err = -ENOMEM;
+    struct scull_kv_entry *e;
+    size_t n;
+    void *q;
+
+    e = kzalloc(struct_size(e, key, k->len), GFP_KERNEL_ACCOUNT);
+    if (!e) return ERR_PTR(-ENOMEM);
+    e->klen = k->len;
+    e->vlen = vlen;
+    memcpy(e->key, k->data, k->len);
+    if (nq) {
+        e->q = kcalloc(nq, sizeof(void *), GFP_KERNEL_ACCOUNT);
+        if (!e->q) goto fail;
+    }
+    while (e->nq < nq) {
+        q = scull_qalloc(dev);
+        if (IS_ERR(q)) {
+            err = PTR_ERR(q);
+            goto fail;
+        }
+        e->q[e->nq++] = q;
+        n = min_t(size_t, vlen, dev->quantum);
+        if (copy_from_user(q, val, n)) {
+            err = -EFAULT;
+            goto fail;
+        }
+        val += n;
+        vlen -= n;
+    }
+    return e;
+
+fail:
+    scull_kv_free(dev, e);
+    return ERR_PTR(err);
+}
+
+static long scull_kv_put(struct scull_dev *dev, const struct scull_kv_key *k,
+                         const char __user *val, u32 vlen) {
+    struct scull_kv_entry *e, *old;
+    int err;
+
+    if (!dev->kv) {
+        dev->kv = kzalloc(sizeof(*dev->kv), GFP_KERNEL_ACCOUNT);
+        if (!dev->kv) return -ENOMEM;
+        err = rhashtable_init(&dev->kv->ht, &scull_kv_params);
+        if (err) {
+            kfree(dev->kv);
+            dev->kv = NULL;
+            return err;
+        }
+    }
+
+    e = scull_kv_alloc(dev, k, val, vlen);
+    if (IS_ERR(e)) return PTR_ERR(e);
+    old = rhashtable_lookup_fast(&dev->kv->ht, k, scull_kv_params);
+    if (old)
+        err = rhashtable_replace_fast(&dev->kv->ht, &old->node, &e->node,
+                                      scull_kv_params);
+    else
+        err = rhashtable_insert_fast(&dev->kv->ht, &e->node, scull_kv_params);
+    if (err) {
+        scull_kv_free(dev, e);
+        return err;
+    }
+    if (old) scull_kv_free(dev, old);
+    return 0;
+}
+
+static long scull_kv_get(struct scull_dev *dev, const struct scull_kv_key *k,
+                         struct scull_kv *a) {
+    struct scull_kv_entry *e;
+    char __user *val = u64_to_user_ptr(a->val);
+    u32 left;
+    size_t n;
+    int i;
+
+    e = dev->kv ? rhashtable_lookup_fast(&dev->kv->ht, k, scull_kv_params)
+                : NULL;
+    if (!e) return -ENOENT;
+    if (a->vlen < e->vlen) {
+        a->vlen = e->vlen;
+        return -ERANGE;
+    }
+    for (i = 0, left = e->vlen; i < e->nq; i++, left -= n) {
+        n = min_t(size_t, left, dev->quantum);
+        if (copy_to_user(val, e->q[i], n)) return -EFAULT;
+        val += n;
+    }
+    a->vlen = e->vlen;
+    return e->vlen;
+}
+
+static long scull_kv_del(struct scull_dev *dev, const struct scull_kv_key *k) {
+    struct scull_kv_entry *e;
+
+    e = dev->kv ? rhashtable_lookup_fast(&dev->kv->ht, k, scull_kv_params)
+                : NULL;
+    if (!e) return -ENOENT;
+    rhashtable_remove_fast(&dev->kv->ht, &e->node, scull_kv_params);
+    scull_kv_free(dev, e);
+    return 0;
+}
+
+// SCULL_IOCKVPUT、SCULL_IOCKVGET 和 SCULL_IOCKVDEL
+long scull_kv_ioctl(struct file *filp, unsigned int cmd,
+                    struct scull_kv __user *arg) {
+    struct scull_dev *dev = filp->private_data;
+    char key[SCULL_KV_KEY_MAX];
+    struct scull_kv_key k = {.data = key};
+    struct scull_kv a;
+    long retval;
+
+    if (copy_from_user(&a, arg, sizeof(a))) return -EFAULT;
+    if (!a.klen || a.klen > SCULL_KV_KEY_MAX) return -EINVAL;
+    if (cmd == SCULL_IOCKVPUT && a.vlen > SCULL_KV_VAL_MAX) return -E2BIG;
+    // 和读写一样检查打开方式
+    if (!(filp->f_mode & (cmd == SCULL_IOCKVGET ? FMODE_READ : FMODE_WRITE)))
+        return -EBADF;
+    if (copy_from_user(key, u64_to_user_ptr(a.key), a.klen)) return -EFAULT;
+    k.len = a.klen;
+
+    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+    switch (cmd) {
+        case SCULL_IOCKVPUT:
+            retval = scull_kv_put(dev, &k, u64_to_user_ptr(a.val), a.vlen);
+            break;
+
+        case SCULL_IOCKVGET:
+            retval = scull_kv_get(dev, &k, &a);
+            if ((retval >= 0 || retval == -ERANGE) &&
+                put_user(a.vlen, &arg->vlen))
+                retval = -EFAULT;
+            break;
+
+        default:
+            retval = scull_kv_del(dev, &k);
+            break;
+    }
+    up(&dev->sem);
+    return retval;
+}
+
+// 清空键值存储，在设备销毁时调用，调用者持有互斥锁或者设备已经没有用户
+void scull_kv_clear(struct scull_dev *dev) {
+    if (!dev->kv) return;
+    rhashtable_free_and_destroy(&dev->kv->ht, scull_kv_free_fn, dev);
+    kfree(dev->kv);
+    dev->kv = NULL;
+}
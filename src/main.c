@@ -2,16 +2,25 @@
 #include <linux/init.h>
 #include <linux/ioctl.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>  // 用于 kmalloc 函数
 #include <linux/uaccess.h>  // 用于 copy_*_user 函数，原代码是 #include <asm/uaccess.h>
+#include <linux/uio.h>  // 用于 iov_iter
 
 #include "scull.h"
 
+// 跟踪点只在这一个文件中实例化
+#define CREATE_TRACE_POINTS
+#include "scull_trace.h"
+
 int scull_major = SCULL_MAJOR;      // 设备主编号
 int scull_minor = 0;                // 设备次编号
 int scull_nr_devs = SCULL_NR_DEVS;  // 分配的设备数量
 int scull_quantum = SCULL_QUANTUM;  // 每个 quantum 的字节数
 int scull_qset = SCULL_QSET;        // 每个 qset 的数组长度
+unsigned long scull_limit;          // 每个设备的内存上限（字节），0 表示不限制
 
 // 模块加载时可手动设置参数
 module_param(scull_major, int, S_IRUGO);
@@ -19,17 +28,20 @@ module_param(scull_minor, int, S_IRUGO);
 module_param(scull_nr_devs, int, S_IRUGO);
 module_param(scull_quantum, int, S_IRUGO);
 module_param(scull_qset, int, S_IRUGO);
+module_param(scull_limit, ulong, S_IRUGO);
 
 struct scull_dev *scull_devices;
+static struct proc_dir_entry *scull_proc;  // /proc/scullmem
 
 struct file_operations scull_fops = {
     .owner = THIS_MODULE,
     .llseek = scull_llseek,
-    .read = scull_read,
-    .write = scull_write,
+    .read_iter = scull_read_iter,
+    .write_iter = scull_write_iter,
     .unlocked_ioctl = scull_ioctl,
     .open = scull_open,
     .release = scull_release,
+    .fsync = scull_fsync,
 };
 
 MODULE_LICENSE("Dual BSD/GPL");
@@ -50,26 +62,44 @@ static void scull_setup_cdev(struct scull_dev *dev, int index) {
 }
 
 // 释放整个数据区
+// 键值存储是独立的命名空间，以写方式打开截断设备时保留，
+// 只在设备销毁时由调用者用 scull_kv_clear 释放
 int scull_trim(struct scull_dev *dev) {
     struct scull_qset *next, *dptr;
     int qset = dev->qset;
     int i;
 
+    trace_scull_trim(dev->cdev.dev, dev->size);
     // 遍历 qset 链表
     for (dptr = dev->data; dptr; dptr = next) {
         // 释放 qset 保存的数据
         if (dptr->data) {
-            // 注意这里是一个二维数组的释放
-            for (i = 0; i < qset; i++) kfree(dptr->data[i]);
+            // 注意这里是一个二维数组的释放，共享的量子只释放引用
+            for (i = 0; i < qset; i++) {
+                if (!dptr->data[i]) continue;
+                if (dptr->meta[i].shared)
+                    scull_shared_put(dptr->meta[i].shared);
+                else
+                    kfree(dptr->data[i]);
+                dev->allocated -= dev->quantum;
+            }
             kfree(dptr->data);
             dptr->data = NULL;
+            kfree(dptr->meta);
+            dptr->meta = NULL;
         }
         next = dptr->next;
         // 释放 qset
         kfree(dptr);
     }
+    // 键值存储的量子仍然计入 allocated
     dev->size = 0;
     dev->data = NULL;
+    dev->cur = NULL;
+    // 所有量子都释放了，LRU 链表中的元数据也一起释放了
+    INIT_LIST_HEAD(&dev->lru);
+    dev->cache_nr = 0;
+    if (dev->backing) scull_wb_truncate(dev);
     return 0;
 }
 
@@ -80,6 +110,9 @@ int scull_open(struct inode *inode, struct file *filp) {
     dev = container_of(inode->i_cdev, struct scull_dev, cdev);
     // 存储指针，方便以后存取
     filp->private_data = dev;
+    // 读写路径支持 IOCB_NOWAIT，允许 io_uring 和 RWF_NOWAIT 直接在提交线程中完成请求
+    filp->f_mode |= FMODE_NOWAIT;
+    trace_scull_open(dev->cdev.dev, filp->f_mode);
 
     // 如果以写入方式打开，则将设备的数据长度截取为0，即清空设备数据。
     if ((filp->f_flags & O_ACCMODE) == O_WRONLY) {
@@ -91,143 +124,323 @@ int scull_open(struct inode *inode, struct file *filp) {
 }
 
 // 文件释放时使用这个函数，一般用于关闭硬件，由于scull没有硬件，因此直接返回0
-int scull_release(struct inode *inode, struct file *filp) { return 0; }
+int scull_release(struct inode *inode, struct file *filp) {
+    trace_scull_release(inode->i_rdev, filp->f_mode);
+    return 0;
+}
+
+// 绑定了后备文件时把修改写回文件，否则什么都不做
+int scull_fsync(struct file *filp, loff_t start, loff_t end, int datasync) {
+    return scull_wb_flush(filp->private_data);
+}
 
 // 定位到指定的量子集合
+// 记住上一次定位的结果，偏移量递增的访问（顺序读写、批量 ioctl）从那里继续，不用每次从链表头开始
 struct scull_qset *scull_follow(struct scull_dev *dev, int n) {
     struct scull_qset *qs = dev->data;
+    int item = n;
+
+    if (dev->cur && dev->cur_item <= n) {
+        qs = dev->cur;
+        n -= dev->cur_item;
+    }
 
     // 如果当前设备还没有量子集合，则先分配一个
     if (!qs) {
-        qs = dev->data = kmalloc(sizeof(struct scull_qset), GFP_KERNEL);
+        // 设备的内存计入写入者所在的 memory cgroup，下同
+        qs = dev->data =
+            kmalloc(sizeof(struct scull_qset), GFP_KERNEL_ACCOUNT);
         if (qs == NULL) return NULL;
+        scull_stat_add(dev->stats, SCULL_STAT_ALLOCS, 1);
         memset(qs, 0, sizeof(struct scull_qset));
     }
 
     // 寻找下一个量子集合，如果不存在也分配一个
     while (n--) {
         if (!qs->next) {
-            qs->next = kmalloc(sizeof(struct scull_qset), GFP_KERNEL);
+            qs->next =
+                kmalloc(sizeof(struct scull_qset), GFP_KERNEL_ACCOUNT);
             if (qs->next == NULL) return NULL;
+            scull_stat_add(dev->stats, SCULL_STAT_ALLOCS, 1);
             memset(qs->next, 0, sizeof(struct scull_qset));
         }
         qs = qs->next;
         continue;
     }
+    dev->cur = qs;
+    dev->cur_item = item;
     return qs;
 }
 
-// 从scull的内存区域中读取数据
-ssize_t scull_read(struct file *filp, char __user *buf, size_t count,
-                   loff_t *f_pos) {
-    // 从 private_data 中得到 scull_dev 结构体
-    struct scull_dev *dev = filp->private_data;
+// 从scull的内存区域中读取数据，只处理 pos 所在的一个量子，返回读取的字节数
+// 调用者持有互斥锁，并负责更新偏移量
+ssize_t scull_read_locked(struct scull_dev *dev, loff_t pos,
+                          struct iov_iter *to) {
+    size_t count = iov_iter_count(to);
     struct scull_qset *dptr;
     // 获得两个大小常量
     int quantum = dev->quantum, qset = dev->qset;
     // 计算每个量子集合可以保存的数据大小
     int itemsize = quantum * qset;
     int item, s_pos, q_pos, rest;
-    ssize_t retval = 0;
+    int retval;
 
-    // 获取信号量，可中断
-    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
     // 如果偏移量大于当前设备的数据长度，则错误。
     // 比如总数据量只有 100 字节，但读了第 120 个字节
-    if (*f_pos >= dev->size) goto out;
+    if (pos >= dev->size) return 0;
     // 如果读取的长度超过了当前设备的数据长度，则截断。
     // 比如总数据量是100，当前偏移量是90，但要读的长度是20，那么110超过了总长度，因此把要读的长度修改为10
-    if (*f_pos + count > dev->size) count = dev->size - *f_pos;
+    if (pos + count > dev->size) count = dev->size - pos;
 
     // 计算要读取的数据的位置
-    // 假设f_pos=4100200，itemsize=4000000，qset=1000
+    // 假设pos=4100200，itemsize=4000000，qset=1000
     // 则item=1，表示第2个量子集合。
     // rest=100200，表示第2个量子集合内的偏移量
     // s_pos=100，表示在第2个量子集合的第100个量子内
     // q_pos=200，表示在第2个量子集合的第100个量子的第200字节位置
-    item = (long)*f_pos / itemsize;
-    rest = (long)*f_pos % itemsize;
+    item = (long)pos / itemsize;
+    rest = (long)pos % itemsize;
     s_pos = rest / quantum;
     q_pos = rest % quantum;
 
     // 根据上文假设，此处是找到第2个量子集合
     dptr = scull_follow(dev, item);
 
-    // 三个出错情况：
-    // 1. 找不到指定量子集合，这一般是kmalloc的错误
-    // 2. 该量子集合没有数据保存，这一般是数据长度有误
-    // 3. 该量子集合的对应量子没有数据，这一般也是数据长度有误
-    if (dptr == NULL || !dptr->data || !dptr->data[s_pos]) goto out;
+    // 找不到指定量子集合，这一般是kmalloc的错误
+    if (dptr == NULL) return 0;
 
     // 只处理单个量子的数据，即不跨量子读取数据
     // 比如单个量子最多保存4000字节数据，当前偏移量处于3900，读的长度是200，则把要读的长度修改为100
     if (count > quantum - q_pos) count = quantum - q_pos;
 
-    // 把内核空间以dptr->data[s_pos] + q_pos为起始地址，复制count字节到用户空间的buf中
-    // copy_to_user 会进行地址空间的转换
-    if (copy_to_user(buf, dptr->data[s_pos] + q_pos, count)) {
-        retval = -EFAULT;
-        goto out;
+    if (!dptr->data || !dptr->data[s_pos] ||
+        (dev->cache && scull_cache_expire(dev, dptr, s_pos))) {
+        // 缓存模式下空洞是被淘汰或者过期的量子，没有命中
+        if (dev->cache) {
+            scull_stat_add(dev->stats, SCULL_STAT_CACHE_MISS, 1);
+            return -ENODATA;
+        }
+        // 数据长度以内没有分配的量子是空洞：跳过没有写入的区域，或者内容全零而被释放的量子，
+        // 读出来都是零
+        if (iov_iter_zero(count, to) != count) return -EFAULT;
+        return count;
     }
-    // 修改当前偏移量
-    *f_pos += count;
-    retval = count;
+    // 量子可能已经被压缩
+    retval = scull_zload(dev, dptr, s_pos);
+    if (retval) return retval;
+    if (dev->cache) {
+        scull_cache_touch(dev, dptr, s_pos);
+        scull_stat_add(dev->stats, SCULL_STAT_CACHE_HIT, 1);
+    }
+    // 把内核空间以dptr->data[s_pos] + q_pos为起始地址，复制count字节到迭代器描述的缓冲区中
+    // copy_to_iter 会根据迭代器类型（用户空间 iovec、io_uring 固定缓冲区等）选择复制方式
+    if (copy_to_iter(dptr->data[s_pos] + q_pos, count, to) != count)
+        return -EFAULT;
+    return count;
+}
 
-out:
+static ssize_t scull_do_read(struct kiocb *iocb, struct iov_iter *to) {
+    // 从 private_data 中得到 scull_dev 结构体
+    struct scull_dev *dev = iocb->ki_filp->private_data;
+    ssize_t retval;
+
+    // 获取信号量，可中断；IOCB_NOWAIT 时只尝试加锁
+    retval = scull_down(&dev->sem, iocb, dev->stats);
+    if (retval) return retval;
+    // 文件偏移量保存在 kiocb 中，由 VFS 负责写回 filp->f_pos
+    retval = scull_read_locked(dev, iocb->ki_pos, to);
+    // 修改当前偏移量
+    if (retval > 0) iocb->ki_pos += retval;
     // 释放信号量
     up(&dev->sem);
     return retval;
 }
 
-// 往scull的内存区域中写入数据，除了在没有数据区域时要创建之外，其他过程和read基本一致，注释见read
-ssize_t scull_write(struct file *filp, const char __user *buf, size_t count,
-                    loff_t *f_pos) {
-    struct scull_dev *dev = filp->private_data;
-    struct scull_qset *dptr;
+// 找到 pos 所在的量子集合，并确保它的数据区域和元数据已经分配
+// 通过 s_pos 返回量子在集合中的下标，调用者持有互斥锁
+struct scull_qset *scull_locate(struct scull_dev *dev, loff_t pos, int *s_pos) {
     int quantum = dev->quantum, qset = dev->qset;
     int itemsize = quantum * qset;
-    int item, s_pos, q_pos, rest;
-    ssize_t retval = -ENOMEM;  // 默认返回值
-
-    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+    struct scull_qset *dptr;
 
-    item = (long)*f_pos / itemsize;
-    rest = (long)*f_pos % itemsize;
-    s_pos = rest / quantum;
-    q_pos = rest % quantum;
-    dptr = scull_follow(dev, item);
-    if (dptr == NULL) goto out;
-    // 创建一个量子集合的数据区域
+    dptr = scull_follow(dev, (long)pos / itemsize);
+    if (dptr == NULL) return NULL;
+    *s_pos = (long)pos % itemsize / quantum;
+    // 创建一个量子集合的数据区域和对应的元数据
     if (!dptr->data) {
-        dptr->data = kmalloc(qset * sizeof(char *), GFP_KERNEL);
-        if (!dptr->data) goto out;
+        dptr->meta =
+            kcalloc(qset, sizeof(struct scull_qmeta), GFP_KERNEL_ACCOUNT);
+        if (!dptr->meta) return NULL;
+        dptr->data = kmalloc(qset * sizeof(char *), GFP_KERNEL_ACCOUNT);
+        if (!dptr->data) {
+            kfree(dptr->meta);
+            dptr->meta = NULL;
+            return NULL;
+        }
         memset(dptr->data, 0, qset * sizeof(char *));
+        scull_stat_add(dev->stats, SCULL_STAT_ALLOCS, 1);
     }
-    // 创建一个量子的数据区域
-    if (!dptr->data[s_pos]) {
-        dptr->data[s_pos] = kmalloc(quantum, GFP_KERNEL);
-        if (!dptr->data[s_pos]) goto out;
-        // 这里相较于原代码补充了一个memset
-        memset(dptr->data[s_pos], 0, quantum);
+    return dptr;
+}
+
+// 分配一个量子，计入设备的内存上限，调用者持有互斥锁
+void *scull_qalloc(struct scull_dev *dev) {
+    void *q;
+
+    // 不能超过设备的内存上限
+    if (dev->limit && dev->allocated + dev->quantum > dev->limit)
+        return ERR_PTR(-ENOSPC);
+    q = kmalloc(dev->quantum, GFP_KERNEL_ACCOUNT);
+    if (!q) return ERR_PTR(-ENOMEM);
+    dev->allocated += dev->quantum;
+    scull_stat_add(dev->stats, SCULL_STAT_ALLOCS, 1);
+    return q;
+}
+
+// 释放一个量子，之后这个位置是空洞，共享的量子只释放引用。调用者持有互斥锁
+void scull_qfree(struct scull_dev *dev, struct scull_qset *dptr, int i) {
+    if (dptr->meta[i].lru.next) {
+        list_del(&dptr->meta[i].lru);
+        dev->cache_nr--;
     }
+    if (dptr->meta[i].shared)
+        scull_shared_put(dptr->meta[i].shared);
+    else
+        kfree(dptr->data[i]);
+    dptr->data[i] = NULL;
+    dev->allocated -= dev->quantum;
+    memset(&dptr->meta[i], 0, sizeof(struct scull_qmeta));
+}
 
-    if (count > quantum - q_pos) count = quantum - q_pos;
+// 检查迭代器接下来的 count 字节是否全零。全零时跳过这些字节并返回真，
+// 否则迭代器退回原来的位置，由调用者照常写入
+static bool scull_iter_zero(struct iov_iter *from, size_t count) {
+    char buf[64];
+    size_t done = 0, n, copied;
+
+    while (done < count) {
+        n = min(count - done, sizeof(buf));
+        copied = copy_from_iter(buf, n, from);
+        done += copied;
+        if (copied != n || memchr_inv(buf, 0, n)) {
+            iov_iter_revert(from, done);
+            return false;
+        }
+    }
+    return true;
+}
 
-    if (copy_from_user(dptr->data[s_pos] + q_pos, buf, count)) {
-        retval = -EFAULT;
+// 往scull的内存区域中写入数据，除了在没有数据区域时要创建之外，其他过程和read基本一致，注释见read
+ssize_t scull_write_locked(struct scull_dev *dev, loff_t pos,
+                           struct iov_iter *from) {
+    size_t count = iov_iter_count(from);
+    struct scull_qset *dptr;
+    int quantum = dev->quantum;
+    int s_pos, q_pos;
+    int retval;
+    void *q;
+
+    dptr = scull_locate(dev, pos, &s_pos);
+    if (dptr == NULL) return -ENOMEM;
+    q_pos = (long)pos % quantum;
+    if (count > quantum - q_pos) count = quantum - q_pos;
+    // 空洞中写入零，内容不变，不需要分配量子；缓存模式下空洞表示没有命中，照常保存
+    if (!dptr->data[s_pos] && !dev->cache && scull_iter_zero(from, count)) {
+        scull_stat_add(dev->stats, SCULL_STAT_ZERO, 1);
         goto out;
     }
-    *f_pos += count;
-    retval = count;
+    // 创建一个量子的数据区域
+    if (!dptr->data[s_pos]) {
+        // 缓存模式下超出预算时先淘汰最久没有访问的量子
+        if (dev->cache) scull_cache_make_room(dev);
+        q = scull_qalloc(dev);
+        if (IS_ERR(q)) return PTR_ERR(q);
+        dptr->data[s_pos] = q;
+        // 这里相较于原代码补充了一个memset
+        memset(q, 0, quantum);
+    } else if (dptr->meta[s_pos].shared) {
+        // 共享的量子，写入前复制一份
+        if (scull_unshare(dev, dptr, s_pos)) return -ENOMEM;
+    }
+    // 量子可能已经被压缩
+    retval = scull_zload(dev, dptr, s_pos);
+    if (retval) return retval;
+    // 内容变了，重新尝试压缩
+    dptr->meta[s_pos].flags &= ~SCULL_Q_INCOMPRESSIBLE;
+    if (dev->cache) scull_cache_touch(dev, dptr, s_pos);
+
+    if (copy_from_iter(dptr->data[s_pos] + q_pos, count, from) != count)
+        return -EFAULT;
+
+    if (!dev->cache && !memchr_inv(dptr->data[s_pos] + q_pos, 0, count) &&
+        !memchr_inv(dptr->data[s_pos], 0, quantum)) {
+        // 写入的是零，并且整个量子都是零，不需要保存，读取时按空洞处理
+        // 缓存模式下空洞表示没有命中，全零的量子也要保存
+        scull_qfree(dev, dptr, s_pos);
+        scull_stat_add(dev->stats, SCULL_STAT_ZERO, 1);
+    } else if (dev->dedup && q_pos + count == quantum) {
+        // 量子写满了，尝试和内容相同的量子共享
+        scull_dedup(dev, dptr, s_pos);
+    }
+out:
+    // 绑定了后备文件时，变成空洞的量子也要写回
+    if (dev->backing) scull_wb_dirty(dev, &dptr->meta[s_pos]);
 
     // 更新设备保存的数据大小
-    if (dev->size < *f_pos) dev->size = *f_pos;
+    if (dev->size < pos + count) dev->size = pos + count;
+    return count;
+}
 
-out:
+static ssize_t scull_do_write(struct kiocb *iocb, struct iov_iter *from) {
+    struct scull_dev *dev = iocb->ki_filp->private_data;
+    ssize_t retval;
+
+    retval = scull_down(&dev->sem, iocb, dev->stats);
+    if (retval) return retval;
+    retval = scull_write_locked(dev, iocb->ki_pos, from);
+    if (retval > 0) iocb->ki_pos += retval;
     up(&dev->sem);
     return retval;
 }
 
+// 使用 read_iter 接口，普通 read、readv 以及 io_uring 都会走到这里
+// 在实际的读写外面统计次数、字节数和耗时，并触发跟踪点
+ssize_t scull_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    struct scull_dev *dev = iocb->ki_filp->private_data;
+    size_t count = iov_iter_count(to);
+    loff_t pos = iocb->ki_pos;
+    ssize_t retval;
+    u64 start, ns;
+
+    // 统计和跟踪都关闭时不需要计时
+    if (!scull_stats_on() && !trace_scull_read_enabled())
+        return scull_do_read(iocb, to);
+    start = local_clock();
+    retval = scull_do_read(iocb, to);
+    ns = local_clock() - start;
+    scull_stat_io(dev->stats, false, count, retval, ns);
+    trace_scull_read(dev->cdev.dev, pos, count, retval, ns);
+    return retval;
+}
+
+ssize_t scull_write_iter(struct kiocb *iocb, struct iov_iter *from) {
+    struct scull_dev *dev = iocb->ki_filp->private_data;
+    size_t count = iov_iter_count(from);
+    loff_t pos = iocb->ki_pos;
+    ssize_t retval;
+    u64 start, ns;
+
+    // 统计和跟踪都关闭时不需要计时
+    if (!scull_stats_on() && !trace_scull_write_enabled())
+        return scull_do_write(iocb, from);
+    start = local_clock();
+    retval = scull_do_write(iocb, from);
+    ns = local_clock() - start;
+    scull_stat_io(dev->stats, true, count, retval, ns);
+    trace_scull_write(dev->cdev.dev, pos, count, retval, ns);
+    return retval;
+}
+
 long scull_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
     int err = 0, tmp;
     int retval = 0;
@@ -315,6 +528,87 @@ long scull_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
         case SCULL_P_IOCQSIZE:
             return scull_p_buffer;
 
+        // 后台压缩只处理 scull0 等静态设备，私有设备不支持
+        case SCULL_IOCTCOMPRESS:
+            if (filp->f_op != &scull_fops) return -ENOTTY;
+            scull_zset(filp->private_data, arg);
+            break;
+
+        case SCULL_IOCQCOMPRESS:
+            if (filp->f_op != &scull_fops) return -ENOTTY;
+            return ((struct scull_dev *)filp->private_data)->compress_ms;
+
+        // 已经共享的量子在关闭后保持共享，写入时再复制
+        case SCULL_IOCTDEDUP:
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            ((struct scull_dev *)filp->private_data)->dedup = !!arg;
+            break;
+
+        case SCULL_IOCQDEDUP:
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            return ((struct scull_dev *)filp->private_data)->dedup;
+
+        // 内存上限用来保护整个系统，只有管理员可以修改
+        case SCULL_IOCTLIMIT:
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            if (!capable(CAP_SYS_RESOURCE)) return -EPERM;
+            ((struct scull_dev *)filp->private_data)->limit = arg;
+            break;
+
+        case SCULL_IOCQLIMIT:
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            return ((struct scull_dev *)filp->private_data)->limit;
+
+        case SCULL_IOCTBACKING:
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            return scull_wb_bind(filp->private_data, (int)arg);
+
+        case SCULL_IOCFLUSH:
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            return scull_wb_flush(filp->private_data);
+
+        case SCULL_IOCCOPY: {
+            struct scull_copy c;
+
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            if (copy_from_user(&c, (void __user *)arg, sizeof(c)))
+                return -EFAULT;
+            return scull_copy(filp, &c);
+        }
+
+        case SCULL_IOCBATCH: {
+            struct scull_batch b;
+
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            if (copy_from_user(&b, (void __user *)arg, sizeof(b)))
+                return -EFAULT;
+            return scull_batch(filp, &b);
+        }
+
+        case SCULL_IOCKVPUT:
+        case SCULL_IOCKVGET:
+        case SCULL_IOCKVDEL:
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            return scull_kv_ioctl(filp, cmd, (struct scull_kv __user *)arg);
+
+        case SCULL_IOCSCACHE: {
+            struct scull_cache c;
+
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            if (copy_from_user(&c, (void __user *)arg, sizeof(c)))
+                return -EFAULT;
+            return scull_cache_set(filp->private_data, &c);
+        }
+
+        case SCULL_IOCGCACHE: {
+            struct scull_cache c;
+
+            if (!scull_is_dev(filp)) return -ENOTTY;
+            scull_cache_get(filp->private_data, &c);
+            if (copy_to_user((void __user *)arg, &c, sizeof(c))) return -EFAULT;
+            break;
+        }
+
         default:  // 多余的，因为检查了 _IOC_NR(cmd)
             return -ENOTTY;
     }
@@ -346,14 +640,144 @@ loff_t scull_llseek(struct file *filp, loff_t off, int whence) {
     return newpos;
 }
 
+// /proc/scullmem：每个设备的内存布局报告，用来为不同的负载选择 quantum 和 qset
+// 使用 seq_file 逐个设备输出，每次只持有当前设备的互斥锁，不会在整个输出期间阻塞所有设备
+
+// 一个设备的内存使用情况
+struct scull_mem_info {
+    unsigned long qsets;     // 量子集合的数量
+    unsigned long quanta;    // 已分配的量子数量
+    unsigned long holes;     // 数据范围内没有分配的量子数量
+    unsigned long slack;     // 已分配的量子中没有存放数据的字节数
+    unsigned long memory;    // 实际占用的内存（包括 slab 取整）
+    long overhead;           // 占用的内存减去存放的数据量，压缩后可能是负数
+    unsigned long zquanta;   // 被压缩的量子数量
+    unsigned long zbytes;    // 被压缩的量子压缩后的字节数
+    unsigned long shared;    // 引用共享内容的量子数量
+};
+
+// 遍历设备的量子集合链表，调用者持有互斥锁
+static void scull_mem_scan(struct scull_dev *dev, struct scull_mem_info *info) {
+    struct scull_qset *dptr;
+    unsigned long k = 0, end, used;
+    int i;
+
+    memset(info, 0, sizeof(*info));
+    // 覆盖 [0, size) 需要的量子数量
+    end = DIV_ROUND_UP(dev->size, dev->quantum);
+    for (dptr = dev->data; dptr; dptr = dptr->next, k += dev->qset) {
+        info->qsets++;
+        info->memory += ksize(dptr);
+        if (!dptr->data) {
+            info->holes += clamp(end, k, k + dev->qset) - k;
+            continue;
+        }
+        info->memory += ksize(dptr->data) + ksize(dptr->meta);
+        for (i = 0; i < dev->qset; i++) {
+            if (!dptr->data[i]) {
+                if (k + i < end) info->holes++;
+                continue;
+            }
+            info->quanta++;
+            if (dptr->meta[i].shared) {
+                // 共享的内存按引用数量平摊
+                info->shared++;
+                info->memory += ksize(dptr->data[i]) /
+                                READ_ONCE(dptr->meta[i].shared->ref);
+            } else {
+                info->memory += ksize(dptr->data[i]);
+            }
+            if (dptr->meta[i].zlen) {
+                info->zquanta++;
+                info->zbytes += dptr->meta[i].zlen;
+            }
+            // 最后一个量子可能只有一部分存放了数据
+            used = (k + i) * dev->quantum;
+            used = dev->size > used
+                       ? min(dev->size - used, (unsigned long)dev->quantum)
+                       : 0;
+            info->slack += dev->quantum - used;
+        }
+    }
+    // 链表没有覆盖到的部分也是空洞
+    if (end > k) info->holes += end - k;
+    info->overhead = (long)info->memory -
+                     (long)(info->quanta * dev->quantum - info->slack);
+}
+
+static void *scull_seq_start(struct seq_file *s, loff_t *pos) {
+    if (*pos == 0) return SEQ_START_TOKEN;
+    if (*pos > scull_nr_devs) return NULL;
+    return scull_devices + *pos - 1;
+}
+
+static void *scull_seq_next(struct seq_file *s, void *v, loff_t *pos) {
+    (*pos)++;
+    if (*pos > scull_nr_devs) return NULL;
+    return scull_devices + *pos - 1;
+}
+
+static void scull_seq_stop(struct seq_file *s, void *v) {}
+
+static int scull_seq_show(struct seq_file *s, void *v) {
+    struct scull_dev *dev = v;
+    struct scull_mem_info info;
+    unsigned long buffers, refs;
+
+    if (v == SEQ_START_TOKEN) {
+        seq_printf(s,
+                   "%-8s %12s %8s %6s %6s %8s %8s %10s %12s %12s %8s %12s %8s\n",
+                   "device", "size", "quantum", "qset", "qsets", "quanta",
+                   "holes", "slack", "memory", "overhead", "zquanta",
+                   "zbytes", "shared");
+        return 0;
+    }
+    // 只在遍历当前设备时持有它的锁
+    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+    scull_mem_scan(dev, &info);
+    seq_printf(s,
+               "scull%-3d %12lu %8d %6d %6lu %8lu %8lu %10lu %12lu %12ld %8lu %12lu %8lu\n",
+               (int)(dev - scull_devices), dev->size, dev->quantum, dev->qset,
+               info.qsets, info.quanta, info.holes, info.slack, info.memory,
+               info.overhead, info.zquanta, info.zbytes, info.shared);
+    up(&dev->sem);
+
+    // 最后一个设备之后输出所有设备的去重效果
+    if (dev == scull_devices + scull_nr_devs - 1) {
+        scull_dedup_summary(&buffers, &refs);
+        seq_printf(s, "\ndedup: %lu shared buffers, %lu references, %lu quanta saved\n",
+                   buffers, refs, refs - buffers);
+    }
+    return 0;
+}
+
+static const struct seq_operations scull_seq_ops = {
+    .start = scull_seq_start,
+    .next = scull_seq_next,
+    .stop = scull_seq_stop,
+    .show = scull_seq_show,
+};
+
 static void scull_cleanup_module(void) {
     int i;
     dev_t devno = MKDEV(scull_major, scull_minor);
 
+    proc_remove(scull_proc);
+    // 后台压缩会访问设备，先停止
+    scull_zcleanup();
+    scull_cache_exit();
+    // 先删除 debugfs 文件，再释放它们引用的计数器
+    scull_stats_cleanup();
+
     if (scull_devices) {
         for (i = 0; i < scull_nr_devs; i++) {
+            // 先把修改写回后备文件，再释放数据
+            scull_cache_release(scull_devices + i);
+            scull_wb_cleanup(scull_devices + i);
             scull_trim(scull_devices + i);
+            scull_kv_clear(scull_devices + i);
             cdev_del(&scull_devices[i].cdev);
+            free_percpu(scull_devices[i].stats);
         }
         kfree(scull_devices);
     }
@@ -363,7 +787,7 @@ static void scull_cleanup_module(void) {
 
     // 清理其他关联设备
     scull_p_cleanup();
-    // scull_access_cleanup();
+    scull_access_cleanup();
 
     printk(KERN_ALERT "[scull] Goodbye, cruel world\n");
 }
@@ -371,6 +795,7 @@ static void scull_cleanup_module(void) {
 static int scull_init_module(void) {
     int result, i;
     dev_t dev = 0;
+    char name[24];  // "scull" 加上任意的 int
 
     if (scull_major) {
         // 已手动指定设备编号
@@ -387,6 +812,10 @@ static int scull_init_module(void) {
         return result;
     }
 
+    result = scull_zinit();
+    if (result) goto fail;
+    scull_cache_init();
+
     // 分配 dev 结构体的内存空间
     scull_devices =
         kmalloc(scull_nr_devs * sizeof(struct scull_dev), GFP_KERNEL);
@@ -396,11 +825,30 @@ static int scull_init_module(void) {
     }
     memset(scull_devices, 0, scull_nr_devs * sizeof(struct scull_dev));
 
+    // 分配统计计数器，失败时设备还没有加入系统，直接释放
+    for (i = 0; i < scull_nr_devs; i++) {
+        scull_devices[i].stats = alloc_percpu(struct scull_stats);
+        if (!scull_devices[i].stats) {
+            while (i--) free_percpu(scull_devices[i].stats);
+            kfree(scull_devices);
+            scull_devices = NULL;
+            result = -ENOMEM;
+            goto fail;
+        }
+    }
+
+    scull_stats_init();
+
     // 初始化 dev 结构体
     for (i = 0; i < scull_nr_devs; i++) {
+        snprintf(name, sizeof(name), "scull%d", i);
+        scull_stats_register(name, scull_devices[i].stats);
         // 设置两个和大小相关的常量
         scull_devices[i].quantum = scull_quantum;
         scull_devices[i].qset = scull_qset;
+        scull_devices[i].limit = scull_limit;
+        scull_wb_init(&scull_devices[i]);
+        scull_cache_setup(&scull_devices[i]);
         // 初始化互斥锁，原代码是init_MUTEX(&scull_devices[i].sem);
         sema_init(&scull_devices[i].sem, 1);
         scull_setup_cdev(&scull_devices[i], i);
@@ -409,7 +857,9 @@ static int scull_init_module(void) {
     // 初始化其他关联设备
     dev = MKDEV(scull_major, scull_minor + scull_nr_devs);
     dev += scull_p_init(dev);
-    // dev += scull_access_init(dev);
+    dev += scull_access_init(dev);
+
+    scull_proc = proc_create_seq("scullmem", 0, NULL, &scull_seq_ops);
 
     printk(KERN_ALERT "[scull] Hello, world\n");
     return 0;
@@ -1,17 +1,27 @@
 #include <linux/errno.h>
+#include <linux/eventfd.h>
 #include <linux/fcntl.h>
 #include <linux/fs.h>
+#include <linux/bitmap.h>
 #include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <linux/sched/signal.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/uaccess.h>
+#include <linux/uio.h>
+#include <asm/ioctls.h>  // 用于 FIONREAD
 
 #include "scull.h"
+#include "scull_trace.h"
 
 static int scull_p_nr_devs = SCULL_P_NR_DEVS;  // 管道设备的数量
 int scull_p_buffer = SCULL_P_BUFFER;           // 缓冲区大小
@@ -20,157 +30,760 @@ dev_t scull_p_devno;
 module_param(scull_p_nr_devs, int, 0);
 module_param(scull_p_buffer, int, 0);
 
+// 阻塞读取的长度不小于该值时，使用写者到读者的直接交接，0 表示关闭（默认）。
+// 交接会固定读者的页面，写入也可能只写了一部分就返回，因此默认保持普通的复制语义
+static int scull_p_handoff_min;
+module_param(scull_p_handoff_min, int, 0644);
+
+// 新打开文件的读者忙等预算（微秒），0 表示不忙等，可以用 ioctl 为每个文件单独设置
+static int scull_p_busy_poll;
+module_param(scull_p_busy_poll, int, 0644);
+
 static struct scull_pipe *scull_p_devices;
 
 struct file_operations scull_pipe_fops = {
     .owner = THIS_MODULE,
     .llseek = no_llseek,
-    .read = scull_p_read,
-    .write = scull_p_write,
+    .read_iter = scull_p_read_iter,
+    .write_iter = scull_p_write_iter,
     .poll = scull_p_poll,
-    .unlocked_ioctl = scull_ioctl,
+    .unlocked_ioctl = scull_p_ioctl,
     .open = scull_p_open,
     .release = scull_p_release,
     .fasync = scull_p_fasync,
 };
 
-int scull_p_open(struct inode *inode, struct file *filp) {
-    struct scull_pipe *dev;
+// 从打开的文件得到管道设备
+static inline struct scull_pipe *scull_p_dev(struct file *filp) {
+    return ((struct scull_p_file *)filp->private_data)->dev;
+}
 
-    dev = container_of(inode->i_cdev, struct scull_pipe, cdev);
-    filp->private_data = dev;
+// 请求是否不允许睡眠：以 O_NONBLOCK 打开，或者是 IOCB_NOWAIT 的请求
+static inline bool scull_p_nonblock(struct kiocb *iocb) {
+    return (iocb->ki_filp->f_flags & O_NONBLOCK) ||
+           (iocb->ki_flags & IOCB_NOWAIT);
+}
 
-    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
-    if (!dev->buffer) {
-        // 分配缓冲区
-        dev->buffer = kmalloc(scull_p_buffer, GFP_KERNEL);
-        if (!dev->buffer) {
-            up(&dev->sem);
-            return -ENOMEM;
+// 带事件掩码的唤醒
+// poll/epoll 的等待项会根据掩码过滤，只有关心该事件的等待者才会被唤醒；
+// 阻塞的读者和写者以独占方式排队，每次唤醒只会叫醒其中一个，避免惊群。
+// EPOLLEXCLUSIVE 的 epoll 等待项同样依赖这里的 EPOLLIN/EPOLLOUT 掩码来判断是否消费了这次唤醒
+// 广播模式下每个读者都有自己的数据，需要唤醒所有读者
+static inline void scull_p_wake_readers(struct scull_pipe *dev) {
+    trace_scull_wakeup(dev->cdev.dev, false,
+                       (__force unsigned int)(EPOLLIN | EPOLLRDNORM));
+    __wake_up(&dev->inq, TASK_INTERRUPTIBLE,
+              (dev->flags & SCULL_P_BROADCAST) ? 0 : 1,
+              poll_to_key(EPOLLIN | EPOLLRDNORM));
+}
+
+static inline void scull_p_wake_writers(struct scull_pipe *dev) {
+    trace_scull_wakeup(dev->cdev.dev, true,
+                       (__force unsigned int)(EPOLLOUT | EPOLLWRNORM));
+    wake_up_interruptible_poll(&dev->outq, EPOLLOUT | EPOLLWRNORM);
+}
+
+// 最后一个写者关闭：唤醒所有阻塞的读者让它们读到文件尾，
+// 只关心 POLLOUT 的 poll 等待者也要报告 POLLHUP，因此两个队列都要唤醒
+static inline void scull_p_wake_hangup(struct scull_pipe *dev) {
+    __poll_t key = EPOLLIN | EPOLLRDNORM | EPOLLHUP | EPOLLRDHUP;
+
+    trace_scull_wakeup(dev->cdev.dev, false, (__force unsigned int)key);
+    __wake_up(&dev->inq, TASK_INTERRUPTIBLE, 0, poll_to_key(key));
+    __wake_up(&dev->outq, TASK_INTERRUPTIBLE, 0, poll_to_key(key));
+}
+
+// 计算剩余空间
+static int spacefree(struct scull_pipe *dev) {
+    // 如果读指针和写指针相等，表示缓冲区为空。因此，可用空间为缓冲区的总大小减去1。
+    // 这里减1是为了避免写指针追上读指针，这种情况通常被用来区分“满”和“空”的状态。
+    if (dev->rp == dev->wp) return dev->buffersize - 1;
+    return ((dev->rp + dev->buffersize - dev->wp) % dev->buffersize) - 1;
+}
+
+// 计算从读游标 rp 开始可读取的数据量
+static int scull_p_avail_at(struct scull_pipe *dev, const char *rp) {
+    return (dev->wp - rp + dev->buffersize) % dev->buffersize;
+}
+
+// 计算缓冲区中保存的数据量（从最慢的读游标算起）
+static int scull_p_avail(struct scull_pipe *dev) {
+    return scull_p_avail_at(dev, dev->rp);
+}
+
+// 广播模式：每个读者都有自己的读游标，每个字节会交给所有读者，
+// dev->rp 是最慢的读者的游标，即缓冲区的尾部，写者只受最慢的读者限制
+static inline bool scull_p_broadcast(struct scull_pipe *dev) {
+    return dev->flags & SCULL_P_BROADCAST;
+}
+
+// 读者的读游标：广播模式下是自己的游标，否则所有读者共用 dev->rp
+static inline char *scull_p_cursor(struct scull_pipe *dev,
+                                   struct scull_p_file *pf) {
+    return scull_p_broadcast(dev) ? pf->rp : dev->rp;
+}
+
+// 重新计算广播模式下缓冲区的尾部，调用者持有互斥锁
+// 没有读者时数据不会再被任何人读取，直接丢弃
+static void scull_p_update_tail(struct scull_pipe *dev) {
+    struct scull_p_file *pf;
+    int avail, max = 0;
+
+    dev->rp = dev->wp;
+    list_for_each_entry(pf, &dev->readers, list) {
+        avail = scull_p_avail_at(dev, pf->rp);
+        if (avail > max) {
+            max = avail;
+            dev->rp = pf->rp;
         }
     }
+}
+
+// 所有读者中可读数据量最少的那个（最快的读者），用于判断数据是否刚刚变得可读
+static int scull_p_min_avail(struct scull_pipe *dev) {
+    struct scull_p_file *pf;
+    int avail, min = scull_p_avail(dev);
+
+    if (!scull_p_broadcast(dev)) return min;
+    list_for_each_entry(pf, &dev->readers, list) {
+        avail = scull_p_avail_at(dev, pf->rp);
+        if (avail < min) min = avail;
+    }
+    return min;
+}
+
+// 记录模式：每次 write 写入的数据是一条记录，dev->records 位图标记每条记录在缓冲区中的起点。
+// 写入时清除记录覆盖范围内的旧标记并设置起点，因此 [rp, wp) 范围内的标记总是准确的
+static void scull_p_mark_record(struct scull_pipe *dev, size_t count) {
+    size_t off = dev->wp - dev->buffer;
+    size_t first = min(count, (size_t)dev->buffersize - off);
+
+    bitmap_clear(dev->records, off, first);
+    if (count > first) bitmap_clear(dev->records, 0, count - first);
+    set_bit(off, dev->records);
+}
+
+// 从 p 开始寻找下一条记录的起点，找不到时返回写指针
+static char *scull_p_next_record(struct scull_pipe *dev, char *p) {
+    size_t off = p - dev->buffer, w = dev->wp - dev->buffer, next;
+
+    if (off <= w) {
+        next = find_next_bit(dev->records, w, off);
+    } else {
+        // 数据跨越了缓冲区末尾，先找到末尾，再从头找到写指针
+        next = find_next_bit(dev->records, dev->buffersize, off);
+        if (next >= dev->buffersize) next = find_next_bit(dev->records, w, 0);
+    }
+    return dev->buffer + min(next, w);
+}
 
-    // 初始化缓冲区大小、起始末尾位置、读写位置
-    dev->buffersize = scull_p_buffer;
+// 丢弃缓冲区尾部最旧的至少 n 字节数据，调用者持有互斥锁
+// 记录模式下丢弃整条记录，丢弃量向上取到下一条记录的起点。
+// 游标落在被丢弃区域内的读者被越过（lapped），移动到新的尾部，并记录它们丢失的字节数
+static void scull_p_discard(struct scull_pipe *dev, int n) {
+    char *tail = dev->buffer + (dev->rp - dev->buffer + n) % dev->buffersize;
+    int left, lost;
+    struct scull_p_file *pf;
+
+    if (dev->records) tail = scull_p_next_record(dev, tail);
+    left = scull_p_avail_at(dev, tail);
+
+    if (scull_p_broadcast(dev)) {
+        list_for_each_entry(pf, &dev->readers, list) {
+            lost = scull_p_avail_at(dev, pf->rp) - left;
+            if (lost > 0) {
+                pf->rp = tail;
+                pf->dropped += lost;
+            }
+        }
+    }
+    dev->dropped += scull_p_avail(dev) - left;
+    dev->rp = tail;
+}
+
+// 覆盖模式（以及广播模式下越过慢读者）的写者从不阻塞
+static inline bool scull_p_overwrites(struct scull_pipe *dev) {
+    return dev->flags & (SCULL_P_OVERWRITE | SCULL_P_LAP);
+}
+
+// 剩余空间不够时丢弃最旧的数据，腾出本次写入需要的空间
+static void scull_p_make_room(struct scull_pipe *dev, size_t count) {
+    int need = min_t(size_t, max_t(size_t, count, dev->sndlowat),
+                     dev->buffersize - 1);
+
+    if (spacefree(dev) < need) scull_p_discard(dev, need - spacefree(dev));
+}
+
+// 读低水位：缓冲区中至少有这么多数据时才唤醒读者、报告可读、发送 SIGIO
+// 水位不能超过缓冲区能容纳的数据量，否则读者永远等不到
+static inline int scull_p_rcvlowat(struct scull_pipe *dev) {
+    return min(dev->rcvlowat, dev->buffersize - 1);
+}
+
+// 写低水位：缓冲区中至少有这么多剩余空间时才唤醒写者、报告可写。
+// 两个水位之和不能超过缓冲区容量，否则数据量介于两者之间时，
+// 读者等数据、写者等空间，互相等待对方
+static inline int scull_p_sndlowat(struct scull_pipe *dev) {
+    return max(min(dev->sndlowat,
+                   dev->buffersize - 1 - scull_p_rcvlowat(dev)), 1);
+}
+
+// 阻塞读取等待的数据量、阻塞写入等待的剩余空间：低水位，但不超过请求的长度，
+// 和 SO_RCVLOWAT/SO_SNDLOWAT 一样，小于低水位的请求不会一直阻塞
+static inline int scull_p_read_need(struct scull_pipe *dev, size_t count) {
+    return max_t(size_t, min_t(size_t, count, scull_p_rcvlowat(dev)), 1);
+}
+
+static inline int scull_p_write_need(struct scull_pipe *dev, size_t count) {
+    return max_t(size_t, min_t(size_t, count, scull_p_sndlowat(dev)), 1);
+}
+
+// 是否有读者可能可以读取：最慢的读者的数据量达到了读低水位
+static inline bool scull_p_readable(struct scull_pipe *dev) {
+    return dev->rp != dev->wp && scull_p_avail(dev) >= scull_p_rcvlowat(dev);
+}
+
+// 指定的读者是否已经有 need 字节可以读取
+static inline bool scull_p_file_readable(struct scull_pipe *dev,
+                                         struct scull_p_file *pf, int need) {
+    char *rp = scull_p_cursor(dev, pf);
+
+    return rp != dev->wp && scull_p_avail_at(dev, rp) >= need;
+}
+
+static inline bool scull_p_writable(struct scull_pipe *dev) {
+    return spacefree(dev) && spacefree(dev) >= scull_p_sndlowat(dev);
+}
+
+// 数据量、剩余空间还没有达到低水位时，只有等待量更小的读者、写者可以继续，
+// 它们不以独占方式排队，唤醒时全部叫醒，由各自检查条件
+static inline bool scull_p_short_readers(struct scull_pipe *dev) {
+    return dev->rp != dev->wp && atomic_read(&dev->rd_short);
+}
+
+static inline bool scull_p_short_writers(struct scull_pipe *dev) {
+    return spacefree(dev) && atomic_read(&dev->wr_short);
+}
+
+// 文件尾：有写者打开过，而现在所有写者都已关闭。
+// 和 FIFO 一样，读完剩余的数据后读取返回 0；还没有写者打开过的管道不算文件尾，
+// 读者可以先于写者打开并等待
+static inline bool scull_p_eof(struct scull_pipe *dev) {
+    return !READ_ONCE(dev->nwriters) && READ_ONCE(dev->had_writer);
+}
+
+// 替换管道注册的 eventfd，调用者持有互斥锁
+static void scull_p_set_eventfd(struct scull_pipe *dev, struct eventfd_ctx *rd,
+                                struct eventfd_ctx *wr) {
+    if (dev->rd_evfd) eventfd_ctx_put(dev->rd_evfd);
+    if (dev->wr_evfd) eventfd_ctx_put(dev->wr_evfd);
+    dev->rd_evfd = rd;
+    dev->wr_evfd = wr;
+}
+
+// 分配缓冲区并重置读写位置，调用者持有互斥锁
+// 分配的内存计入调用者所在的 memory cgroup
+static int scull_p_alloc_buffer(struct scull_pipe *dev) {
+    struct scull_p_file *pf;
+
+    dev->buffer = kmalloc(dev->buffersize, GFP_KERNEL_ACCOUNT);
+    if (!dev->buffer) return -ENOMEM;
+    scull_stat_add(dev->stats, SCULL_STAT_ALLOCS, 1);
     dev->end = dev->buffer + dev->buffersize;
     dev->rp = dev->wp = dev->buffer;
+    list_for_each_entry(pf, &dev->readers, list) pf->rp = dev->buffer;
+    if (dev->records) bitmap_zero(dev->records, dev->buffersize);
+    return 0;
+}
+
+// 释放缓冲区，调用者持有互斥锁。所有指针都置为 NULL，读写位置相等，管道表现为空
+static void scull_p_free_buffer(struct scull_pipe *dev) {
+    struct scull_p_file *pf;
+
+    kfree(dev->buffer);
+    dev->buffer = dev->end = dev->rp = dev->wp = NULL;
+    list_for_each_entry(pf, &dev->readers, list) pf->rp = NULL;
+}
+
+// 写者到读者的直接交接
+// 缓冲区为空时，阻塞的大块读取先固定（pin）读者缓冲区所在的页面并登记到 dev->handoffs，
+// 随后到来的写者直接把数据从自己的用户空间复制到这些页面中，
+// 省去了先复制进环形缓冲区、再复制给读者的一次内存复制。
+// 只要还有读者在等待交接，缓冲区就保持为空，数据顺序不会被打乱
+struct scull_p_handoff {
+    struct list_head list;     // 链接到 dev->handoffs
+    struct task_struct *task;  // 等待交接的读者
+    struct page **pages;       // 固定的读者缓冲区页面
+    size_t offset;             // 数据在第一个页面中的起始偏移
+    size_t len;                // 读者缓冲区长度
+    size_t copied;             // 写者已经复制的字节数
+    bool done;                 // 写者已经完成交接
+};
+
+int scull_p_open(struct inode *inode, struct file *filp) {
+    struct scull_pipe *dev;
+    struct scull_p_file *pf;
+
+    dev = container_of(inode->i_cdev, struct scull_pipe, cdev);
+
+    // 每个打开的文件都有自己的状态，private_data 指向它而不是设备
+    pf = kzalloc(sizeof(*pf), GFP_KERNEL);
+    if (!pf) return -ENOMEM;
+    pf->dev = dev;
+    pf->busy_poll = pf->busy_budget =
+        clamp(scull_p_busy_poll, 0, SCULL_P_BUSY_POLL_MAX);
+    filp->private_data = pf;
+
+    if (down_interruptible(&dev->sem)) {
+        kfree(pf);
+        return -ERESTARTSYS;
+    }
+    if (dev->nreaders + dev->nwriters == 0) {
+        // 第一个打开者初始化缓冲区大小，并使用默认的低水位和工作模式
+        // 后来的打开者不能把它们重置掉：已经打开的读者（尤其是广播模式下各自的游标）
+        // 还指向缓冲区中的数据
+        dev->buffersize = scull_p_buffer;
+        dev->rcvlowat = dev->sndlowat = 1;
+        dev->flags = 0;
+        dev->dropped = 0;
+        dev->had_writer = false;
+    }
+    // 分配缓冲区，空闲的缓冲区可能被 shrinker 回收了
+    if (!dev->buffer && scull_p_alloc_buffer(dev)) {
+        up(&dev->sem);
+        kfree(pf);
+        return -ENOMEM;
+    }
+
     // 更新读者、写者计数
-    if (filp->f_mode & FMODE_READ) dev->nreaders++;
-    if (filp->f_mode & FMODE_WRITE) dev->nwriters++;
+    if (filp->f_mode & FMODE_READ) {
+        dev->nreaders++;
+        // 读者从当前的写指针开始读取，只能看到打开之后写入的数据（广播模式下有意义）
+        pf->rp = dev->wp;
+        list_add_tail(&pf->list, &dev->readers);
+    }
+    if (filp->f_mode & FMODE_WRITE) {
+        dev->nwriters++;
+        dev->had_writer = true;
+    }
     up(&dev->sem);
 
+    // 读写路径支持 IOCB_NOWAIT，缓冲区不满足条件时返回 -EAGAIN，io_uring 可以通过 poll 重试
+    filp->f_mode |= FMODE_NOWAIT;
+    trace_scull_open(dev->cdev.dev, filp->f_mode);
+
     // 调用 nonseekable_open 函数，标记文件为不支持寻址操作，即不支持随机访问
     return nonseekable_open(inode, filp);
 }
 
 int scull_p_release(struct inode *inode, struct file *filp) {
-    struct scull_pipe *dev = filp->private_data;
+    struct scull_p_file *pf = filp->private_data;
+    struct scull_pipe *dev = pf->dev;
+    struct scull_p_handoff *h;
+    bool hangup = false;
 
+    trace_scull_release(dev->cdev.dev, filp->f_mode);
     // 当设备关闭时，需要从异步队列中删除
     scull_p_fasync(-1, filp, 0);
     down(&dev->sem);
-    if (filp->f_mode & FMODE_READ) dev->nreaders--;
-    if (filp->f_mode & FMODE_WRITE) dev->nwriters--;
+    if (filp->f_mode & FMODE_READ) {
+        dev->nreaders--;
+        list_del(&pf->list);
+        // 广播模式下离开的可能是最慢的读者，缓冲区尾部前移后写者可能可以继续写入
+        if (scull_p_broadcast(dev)) scull_p_update_tail(dev);
+    }
+    if ((filp->f_mode & FMODE_WRITE) && --dev->nwriters == 0 &&
+        dev->nreaders) {
+        hangup = true;
+        // 等待直接交接的读者不在等待队列上，单独唤醒
+        list_for_each_entry(h, &dev->handoffs, list) wake_up_process(h->task);
+        // 读者会读到文件尾，也通知一次读 eventfd
+        if (dev->rd_evfd) eventfd_signal(dev->rd_evfd, 1);
+    }
     // 当读者和写者数量均为0时，释放缓冲区
     if (dev->nreaders + dev->nwriters == 0) {
-        kfree(dev->buffer);
-        dev->buffer = NULL;  // 以便打开时确认是否分配缓冲区
+        scull_p_free_buffer(dev);  // 以便打开时确认是否分配缓冲区
+        bitmap_free(dev->records);
+        dev->records = NULL;
+        scull_p_set_eventfd(dev, NULL, NULL);
     }
     up(&dev->sem);
+    kfree(pf);
+    scull_p_wake_writers(dev);
+    if (hangup) {
+        scull_p_wake_hangup(dev);
+        if (dev->async_queue) kill_fasync(&dev->async_queue, SIGIO, POLL_HUP);
+    }
     return 0;
 }
 
+// 批量读取的目标字节数：不超过本次读取的长度和缓冲区容量
+static inline size_t scull_p_batch_target(struct scull_pipe *dev,
+                                          struct scull_p_file *pf,
+                                          size_t count) {
+    return min3(count, (size_t)pf->vmin, (size_t)(dev->buffersize - 1));
+}
+
+// 本次读取是否可以走直接交接：读取足够大，并且没有设置需要凑够数据量才返回的低水位和批量参数。
+// 开启了忙等的读者追求的是不睡眠，不走需要睡眠等待写者的交接路径；
+// 广播模式下数据要交给所有读者，记录模式下记录不能被拆开，也不能交接
+static bool scull_p_can_handoff(struct scull_pipe *dev, struct scull_p_file *pf,
+                                size_t count) {
+    return scull_p_handoff_min > 0 && count >= scull_p_handoff_min &&
+           pf->vmin <= 1 && scull_p_rcvlowat(dev) <= 1 && !pf->busy_poll &&
+           !(dev->flags & (SCULL_P_BROADCAST | SCULL_P_RECORDS));
+}
+
+// 读者一侧的直接交接，调用时不持有互斥锁
+// 返回读取的字节数或错误码；返回 -EAGAIN 表示无法交接（缓冲区中已有数据或页面无法固定），
+// 调用者应回到普通的读取路径
+static ssize_t scull_p_read_handoff(struct scull_pipe *dev, struct iov_iter *to,
+                                    size_t count) {
+    struct scull_p_handoff h = {.task = current};
+    ssize_t bytes, retval;
+    int i, npages;
+
+    // 固定读者缓冲区的页面（只处理第一个 iovec 段），可能触发缺页，因此不能持有互斥锁
+    bytes = iov_iter_get_pages_alloc(to, &h.pages, count, &h.offset);
+    if (bytes <= 0) return -EAGAIN;
+    h.len = bytes;
+    npages = DIV_ROUND_UP(h.offset + h.len, PAGE_SIZE);
+
+    if (down_interruptible(&dev->sem)) {
+        retval = -ERESTARTSYS;
+        goto out;
+    }
+    // 固定页面期间已经有数据写入了缓冲区
+    if (dev->rp != dev->wp) {
+        up(&dev->sem);
+        retval = -EAGAIN;
+        goto out;
+    }
+    list_add_tail(&h.list, &dev->handoffs);
+    up(&dev->sem);
+
+    for (;;) {
+        set_current_state(TASK_INTERRUPTIBLE);
+        if (smp_load_acquire(&h.done) || signal_pending(current) ||
+            scull_p_eof(dev))
+            break;
+        schedule();
+    }
+    __set_current_state(TASK_RUNNING);
+
+    // 写者在持有互斥锁时完成交接并唤醒读者，这里拿一次锁保证写者已经不再访问 h
+    down(&dev->sem);
+    if (!h.done) list_del(&h.list);
+    up(&dev->sem);
+
+    if (h.done) {
+        iov_iter_advance(to, h.copied);
+        retval = h.copied;
+    } else if (signal_pending(current)) {
+        retval = -ERESTARTSYS;
+    } else {
+        // 写者都已关闭（或者刚好又有写者打开），回到普通路径处理文件尾
+        retval = -EAGAIN;
+    }
+
+out:
+    for (i = 0; i < npages; i++) {
+        if (h.copied) set_page_dirty_lock(h.pages[i]);
+        put_page(h.pages[i]);
+    }
+    kvfree(h.pages);
+    return retval;
+}
+
+// 写者一侧的直接交接，调用者持有互斥锁，并且 dev->handoffs 不为空
+// 返回交接的字节数或错误码
+static ssize_t scull_p_write_handoff(struct scull_pipe *dev,
+                                     struct iov_iter *from) {
+    struct scull_p_handoff *h;
+    size_t pos, n, copied;
+
+    h = list_first_entry(&dev->handoffs, struct scull_p_handoff, list);
+    while (h->copied < h->len && iov_iter_count(from)) {
+        pos = h->offset + h->copied;
+        n = min(PAGE_SIZE - pos % PAGE_SIZE, h->len - h->copied);
+        copied = copy_page_from_iter(h->pages[pos / PAGE_SIZE],
+                                     pos % PAGE_SIZE, n, from);
+        h->copied += copied;
+        if (copied != n) break;
+    }
+    // 一个字节都没有复制成功，读者继续等待下一个写者
+    if (!h->copied) return -EFAULT;
+
+    list_del(&h->list);
+    smp_store_release(&h->done, true);
+    wake_up_process(h->task);
+    return h->copied;
+}
+
+// 读者忙等：睡眠之前先在预算时间内自旋检查写指针，数据很快到达时可以省去一次睡眠和唤醒。
+// 调用时不持有互斥锁，和 wait_event 的条件一样无锁地读取读写指针。
+// 预算是自适应的：自旋等到数据时预算翻倍（不超过设置值），自旋失败时减半，
+// 睡眠后如果数据在设置值以内就到达了，说明值得自旋，预算再翻倍恢复
+static bool scull_p_spin(struct scull_pipe *dev, struct scull_p_file *pf,
+                         int need) {
+    u64 start, end;
+
+    if (!pf->busy_budget) return false;
+    start = local_clock();
+    end = start + (u64)pf->busy_budget * NSEC_PER_USEC;
+    while (!scull_p_file_readable(dev, pf, need) && !scull_p_eof(dev)) {
+        if (need_resched() || signal_pending(current) || local_clock() > end) {
+            pf->busy_budget /= 2;
+            return false;
+        }
+        cpu_relax();
+    }
+    pf->busy_budget = min(pf->busy_budget * 2, pf->busy_poll);
+    return true;
+}
+
 // 管道数据读取
-ssize_t scull_p_read(struct file *filp, char __user *buf, size_t count,
-                     loff_t *f_pos) {
-    struct scull_pipe *dev = filp->private_data;
+static ssize_t scull_p_do_read(struct kiocb *iocb, struct iov_iter *to) {
+    struct scull_p_file *pf = iocb->ki_filp->private_data;
+    struct scull_pipe *dev = pf->dev;
+    size_t count = iov_iter_count(to), chunk, copied, done = 0, target;
+    bool nonblock = scull_p_nonblock(iocb);
+    bool was_writable, more_data, more_space, short_wait;
+    char **rpp, *old;
+    ssize_t retval;
+    long timeout;
+    u64 slept;
+    int result, need;
+
+    result = scull_down(&dev->sem, iocb, dev->stats);
+    if (result) return result;
 
-    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+    // 缓冲区为空时，大块阻塞读取尝试让写者直接把数据交给自己
+    if (!nonblock && dev->rp == dev->wp && !scull_p_eof(dev) &&
+        scull_p_can_handoff(dev, pf, count)) {
+        up(&dev->sem);
+        retval = scull_p_read_handoff(dev, to, count);
+        if (retval != -EAGAIN) return retval;
+        if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+    }
 
-    while (dev->rp == dev->wp) {  // 缓冲区为空（没有可读取的数据）
+again:
+    // 阻塞读需要等到数据量达到读低水位（请求更短时等到请求的长度）；非阻塞读只要有数据就返回。
+    // 写者都已关闭时不会再有数据，剩余的数据不足低水位也直接读走，读完后返回 0
+    need = scull_p_read_need(dev, count);
+    short_wait = need < scull_p_rcvlowat(dev);
+    while (scull_p_cursor(dev, pf) == dev->wp ||
+           (!nonblock && !scull_p_file_readable(dev, pf, need) &&
+            !scull_p_eof(dev))) {
+        if (scull_p_cursor(dev, pf) == dev->wp && scull_p_eof(dev)) {
+            up(&dev->sem);
+            return 0;
+        }
+        // 在释放互斥锁之前登记，之后的写者一定能看到
+        if (!nonblock && short_wait) atomic_inc(&dev->rd_short);
         up(&dev->sem);
         // 如果是非阻塞则返回错误
-        if (filp->f_flags & O_NONBLOCK) return -EAGAIN;
-        // 等待缓冲区有数据
-        printk(KERN_INFO "[scull] pipe reader waiting...");
-        if (wait_event_interruptible(dev->inq, (dev->rp != dev->wp)))
-            // 如果等待中被信号打断，则交给上层VFS来处理
-            return -ERESTARTSYS;
+        if (nonblock) return -EAGAIN;
+        // 先忙等一段时间，数据到达了就不需要睡眠
+        result = 0;
+        if (!scull_p_spin(dev, pf, need)) {
+            // 等待缓冲区有数据
+            slept = local_clock();
+            // 以独占方式等待，写者每次只会唤醒一个读者；
+            // 等待量小于读低水位的读者例外，见 scull_p_short_readers
+            if (short_wait)
+                result = wait_event_interruptible(
+                    dev->inq,
+                    scull_p_file_readable(dev, pf, need) || scull_p_eof(dev));
+            else
+                result = wait_event_interruptible_exclusive(
+                    dev->inq,
+                    scull_p_file_readable(dev, pf, need) || scull_p_eof(dev));
+            slept = local_clock() - slept;
+            scull_stat_time(dev->stats, SCULL_HIST_SLEEP, slept);
+            trace_scull_wait(dev->cdev.dev, false, slept, result);
+            // 睡眠时间在忙等设置值以内，恢复忙等预算
+            if (!result && pf->busy_poll &&
+                slept < (u64)pf->busy_poll * NSEC_PER_USEC)
+                pf->busy_budget = min(max(pf->busy_budget * 2, 1),
+                                      pf->busy_poll);
+        }
+        if (short_wait) atomic_dec(&dev->rd_short);
+        // 如果等待中被信号打断，则交给上层VFS来处理
+        if (result) return -ERESTARTSYS;
         // 重新获得锁，循环
-        if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+        if (down_interruptible(&dev->sem)) {
+            // 本读者可能已经消费了一次独占唤醒，放弃前把它传递给下一个读者
+            scull_p_wake_readers(dev);
+            return -ERESTARTSYS;
+        }
     }
 
     // 已拿到互斥锁，并且缓冲区中有数据
 
-    // 计算可以读取的数据量。如果写指针在读指针后面，直接读取这段数据
-    // 如果写指针已经绕回（缓冲区是循环使用的），则读取到缓冲区末尾的数据。
-    if (dev->wp > dev->rp)
-        count = min(count, (size_t)(dev->wp - dev->rp));
-    else
-        count = min(count, (size_t)(dev->end - dev->rp));
-    if (copy_to_user(buf, dev->rp, count)) {
+    // 批量读取（类似终端的 VMIN/VTIME）：数据量不足 vmin 时继续等待，
+    // 直到凑够 vmin 字节，或者从拿到第一批数据起超过 vtime 毫秒
+    target = scull_p_batch_target(dev, pf, count);
+    if (!nonblock && !scull_p_eof(dev) &&
+        scull_p_avail_at(dev, scull_p_cursor(dev, pf)) < target) {
         up(&dev->sem);
-        return -EFAULT;
+        // 本读者可能消费了一次独占唤醒，但暂时不取走数据，把唤醒传递给下一个读者
+        scull_p_wake_readers(dev);
+        timeout = pf->vtime ? msecs_to_jiffies(pf->vtime) : MAX_SCHEDULE_TIMEOUT;
+        slept = local_clock();
+        // 每个文件的目标不同，这里不能使用独占等待，否则会吞掉其他读者的唤醒
+        timeout = wait_event_interruptible_timeout(
+            dev->inq,
+            scull_p_avail_at(dev, scull_p_cursor(dev, pf)) >= target ||
+                scull_p_eof(dev),
+            timeout);
+        slept = local_clock() - slept;
+        scull_stat_time(dev->stats, SCULL_HIST_SLEEP, slept);
+        trace_scull_wait(dev->cdev.dev, false, slept, timeout < 0 ? timeout : 0);
+        if (timeout < 0) return -ERESTARTSYS;
+        if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+        // 等待期间数据可能被其他读者取走，或者条件刚满足又被取走了一部分，重新检查
+        if (scull_p_cursor(dev, pf) == dev->wp ||
+            (timeout && !scull_p_eof(dev) &&
+             scull_p_avail_at(dev, scull_p_cursor(dev, pf)) < target))
+            goto again;
+    }
+
+    // 计算可以读取的数据量。如果写指针已经绕回（缓冲区是循环使用的），
+    // 数据分成两段：先读到缓冲区末尾，再从缓冲区起始位置继续读，
+    // 这样读者一次就能拿到达到低水位的全部数据
+    was_writable = scull_p_writable(dev);
+    rpp = scull_p_broadcast(dev) ? &pf->rp : &dev->rp;
+    old = *rpp;
+    count = min(count, (size_t)scull_p_avail_at(dev, *rpp));
+    while (done < count) {
+        chunk = min(count - done, (size_t)(dev->end - *rpp));
+        copied = copy_to_iter(*rpp, chunk, to);
+        *rpp += copied;
+        // 更新读指针，如果读到了缓冲区的末尾，则将读指针重置到缓冲区的开始
+        if (*rpp == dev->end) *rpp = dev->buffer;
+        done += copied;
+        if (copied != chunk) break;
     }
-    dev->rp += count;
-    // 更新读指针，如果读到了缓冲区的末尾，则将读指针重置到缓冲区的开始
-    if (dev->rp == dev->end) dev->rp = dev->buffer;
+    // 广播模式下，最慢的读者读取后缓冲区的尾部才会前移
+    if (scull_p_broadcast(dev) && old == dev->rp) scull_p_update_tail(dev);
+    // 广播模式下每次写入都会唤醒所有读者，不需要传递唤醒
+    more_data = !scull_p_broadcast(dev) &&
+                (scull_p_readable(dev) || scull_p_short_readers(dev));
+    more_space = scull_p_writable(dev);
+    // 剩余空间刚刚达到写低水位时通知写者的 eventfd
+    if (dev->wr_evfd && more_space && !was_writable)
+        eventfd_signal(dev->wr_evfd, 1);
+    more_space = more_space || scull_p_short_writers(dev);
     up(&dev->sem);
-    // 唤醒写进程
-    wake_up_interruptible(&dev->outq);
-    return count;
-}
 
-// 计算剩余空间
-static int spacefree(struct scull_pipe *dev) {
-    // 如果读指针和写指针相等，表示缓冲区为空。因此，可用空间为缓冲区的总大小减去1。
-    // 这里减1是为了避免写指针追上读指针，这种情况通常被用来区分“满”和“空”的状态。
-    if (dev->rp == dev->wp) return dev->buffersize - 1;
-    return ((dev->rp + dev->buffersize - dev->wp) % dev->buffersize) - 1;
+    if (!done && count) return -EFAULT;
+    // 剩余空间达到写低水位，或者有等待量更小的写者时才唤醒写进程
+    if (more_space) scull_p_wake_writers(dev);
+    // 缓冲区中还有足够的数据，把唤醒传递给下一个排队的读者
+    if (more_data) scull_p_wake_readers(dev);
+    return done;
 }
 
 // 等待有剩余空间可以写入，调用者必须持有互斥锁。在发生错误返回前，互斥锁会先被释放
-static int scull_getwritespace(struct scull_pipe *dev, struct file *filp) {
-    while (spacefree(dev) == 0) {  // 检查缓冲区空间
+// 阻塞写需要等到剩余空间达到写低水位（写入更短时等到写入的长度）；非阻塞写只要有空间就写入
+static int scull_getwritespace(struct scull_pipe *dev, struct kiocb *iocb,
+                               size_t count) {
+    bool nonblock = scull_p_nonblock(iocb);
+    int need = nonblock ? 1 : scull_p_write_need(dev, count);
+    bool short_wait = need < scull_p_sndlowat(dev);
+    u64 slept;
+
+    // 检查缓冲区空间
+    while (spacefree(dev) < need) {
         // 定义一个等待队列
         DEFINE_WAIT(wait);
+        // 在释放互斥锁之前登记，之后的读者一定能看到
+        if (!nonblock && short_wait) atomic_inc(&dev->wr_short);
         up(&dev->sem);
         // 如果是非阻塞，并且缓冲区已满，直接返回错误
-        if (filp->f_flags & O_NONBLOCK) return -EAGAIN;
+        if (nonblock) return -EAGAIN;
         // 准备等待
         // 1. 将当前进程添加到设备的等待队列 dev->outq 中
         // 2. 设置进程状态为 TASK_INTERRUPTIBLE
-        prepare_to_wait(&dev->outq, &wait, TASK_INTERRUPTIBLE);
+        // 3. 以独占方式排队，读者每次只会唤醒一个写者（等待量小于写低水位的写者除外）
+        if (short_wait)
+            prepare_to_wait(&dev->outq, &wait, TASK_INTERRUPTIBLE);
+        else
+            prepare_to_wait_exclusive(&dev->outq, &wait, TASK_INTERRUPTIBLE);
         // 放弃执行，重新调度，开始睡眠
 
-        if (spacefree(dev) == 0) {
-            printk(KERN_INFO "[scull] pipe writer waiting...");
+        if (spacefree(dev) < need) {
+            slept = local_clock();
             schedule();
+            slept = local_clock() - slept;
+            scull_stat_time(dev->stats, SCULL_HIST_SLEEP, slept);
+            trace_scull_wait(dev->cdev.dev, true, slept,
+                             signal_pending(current) ? -ERESTARTSYS : 0);
         }
         // 从等待队列中移除当前进程，恢复正常的进程状态
         finish_wait(&dev->outq, &wait);
+        if (short_wait) atomic_dec(&dev->wr_short);
         // 如果在等待过程中有信号发送到当前进程，则返回-ERESTARTSYS以通知文件系统层需要处理这个信号
-        if (signal_pending(current)) return -ERESTARTSYS;
-        if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+        if (signal_pending(current)) {
+            // 本写者可能已经消费了一次独占唤醒，放弃前把它传递给下一个写者
+            if (scull_p_writable(dev)) scull_p_wake_writers(dev);
+            return -ERESTARTSYS;
+        }
+        if (down_interruptible(&dev->sem)) {
+            scull_p_wake_writers(dev);
+            return -ERESTARTSYS;
+        }
     }
     return 0;
 }
 
 // 管道数据写入
-ssize_t scull_p_write(struct file *filp, const char __user *buf, size_t count,
-                      loff_t *f_pos) {
-    struct scull_pipe *dev = filp->private_data;
+static ssize_t scull_p_do_write(struct kiocb *iocb, struct iov_iter *from) {
+    struct scull_pipe *dev = scull_p_dev(iocb->ki_filp);
+    size_t count = iov_iter_count(from), chunk, copied, done = 0;
+    bool was_readable, more_data, more_space, wake;
+    ssize_t retval;
     int result;
 
-    if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+    result = scull_down(&dev->sem, iocb, dev->stats);
+    if (result) return result;
+
+    // 缓冲区为空并且有读者在等待交接，直接把数据复制到读者的缓冲区
+    if (count && dev->rp == dev->wp && !list_empty(&dev->handoffs)) {
+        retval = scull_p_write_handoff(dev, from);
+        up(&dev->sem);
+        return retval;
+    }
+
+    // 记录模式下每次写入是一条完整的记录，必须能放进缓冲区
+    if (dev->records && count > dev->buffersize - 1) {
+        up(&dev->sem);
+        return -EMSGSIZE;
+    }
+
+    // 覆盖模式（飞行记录器）和越过慢读者：丢弃最旧的数据而不是等待
+    if (scull_p_overwrites(dev)) scull_p_make_room(dev, count);
 
     // 确保有空间可以写入
-    result = scull_getwritespace(dev, filp);
+    result = scull_getwritespace(dev, iocb, count);
     if (result) return result;  // scull_getwritespace中已经调用了up(&dev->sem);
 
+    // 空闲的缓冲区可能被 shrinker 回收了，重新分配
+    if (!dev->buffer && scull_p_alloc_buffer(dev)) {
+        up(&dev->sem);
+        return -ENOMEM;
+    }
+
+    // 以最快的读者为准判断数据量是否刚刚跨越读低水位
+    was_readable = scull_p_min_avail(dev) >= scull_p_rcvlowat(dev);
+
     // 计算实际写入量
     count = min(count, (size_t)spacefree(dev));
-    if (dev->wp >= dev->rp)
+    if (dev->records)
+        // 记录模式下整条记录一次写入，可能跨越缓冲区末尾分两段复制
+        scull_p_mark_record(dev, count);
+    else if (dev->wp >= dev->rp)
         // 最多写到缓冲区末尾
         count = min(count, (size_t)(dev->end - dev->wp));
     else
@@ -178,49 +791,285 @@ ssize_t scull_p_write(struct file *filp, const char __user *buf, size_t count,
         count = min(count, (size_t)(dev->rp - dev->wp - 1));
 
     // 实际的数据写入
-    if (copy_from_user(dev->wp, buf, count)) {
+    while (done < count) {
+        chunk = min(count - done, (size_t)(dev->end - dev->wp));
+        copied = copy_from_iter(dev->wp, chunk, from);
+        // 更新写指针
+        dev->wp += copied;
+        if (dev->wp == dev->end) dev->wp = dev->buffer;
+        done += copied;
+        if (copied != chunk) break;
+    }
+    if (!done && count) {
         up(&dev->sem);
         return -EFAULT;
     }
-    // 更新写指针
-    dev->wp += count;
-    if (dev->wp == dev->end) dev->wp = dev->buffer;
+    // 广播模式下没有读者时，数据不会被任何人读取
+    if (scull_p_broadcast(dev) && list_empty(&dev->readers))
+        scull_p_update_tail(dev);
+    more_data = scull_p_readable(dev);
+    more_space = scull_p_writable(dev);
+    // 数据量刚刚达到读低水位时通知读者的 eventfd
+    if (dev->rd_evfd && more_data && !was_readable)
+        eventfd_signal(dev->rd_evfd, 1);
+    wake = more_data || scull_p_short_readers(dev);
     up(&dev->sem);
 
-    // 唤醒读进程
-    wake_up_interruptible(&dev->inq);
+    // 数据量达到读低水位，或者有等待量更小的读者时才唤醒读进程
+    if (wake) scull_p_wake_readers(dev);
+    // 缓冲区中还有足够的剩余空间，把唤醒传递给下一个排队的写者
+    if (more_space) scull_p_wake_writers(dev);
 
     // 如果有注册异步通知的进程，通知它们现在可以进行读操作
-    if (dev->async_queue) kill_fasync(&dev->async_queue, SIGIO, POLL_IN);
-    return count;
+    // 信号只在数据量从低水位以下跨越到低水位以上时发送一次，避免每次写入都产生信号
+    if (dev->async_queue && more_data && !was_readable)
+        kill_fasync(&dev->async_queue, SIGIO, POLL_IN);
+    return done;
+}
+
+// 在实际的读写外面统计次数、字节数和耗时，并触发跟踪点。管道没有偏移量，记录为 0
+ssize_t scull_p_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    struct scull_pipe *dev = scull_p_dev(iocb->ki_filp);
+    size_t count = iov_iter_count(to);
+    ssize_t retval;
+    u64 start, ns;
+
+    // 统计和跟踪都关闭时不需要计时
+    if (!scull_stats_on() && !trace_scull_read_enabled())
+        return scull_p_do_read(iocb, to);
+    start = local_clock();
+    retval = scull_p_do_read(iocb, to);
+    ns = local_clock() - start;
+    scull_stat_io(dev->stats, false, count, retval, ns);
+    trace_scull_read(dev->cdev.dev, 0, count, retval, ns);
+    return retval;
+}
+
+ssize_t scull_p_write_iter(struct kiocb *iocb, struct iov_iter *from) {
+    struct scull_pipe *dev = scull_p_dev(iocb->ki_filp);
+    size_t count = iov_iter_count(from);
+    ssize_t retval;
+    u64 start, ns;
+
+    // 统计和跟踪都关闭时不需要计时
+    if (!scull_stats_on() && !trace_scull_write_enabled())
+        return scull_p_do_write(iocb, from);
+    start = local_clock();
+    retval = scull_p_do_write(iocb, from);
+    ns = local_clock() - start;
+    scull_stat_io(dev->stats, true, count, retval, ns);
+    trace_scull_write(dev->cdev.dev, 0, count, retval, ns);
+    return retval;
 }
 
 unsigned int scull_p_poll(struct file *filp, poll_table *wait) {
-    struct scull_pipe *dev = filp->private_data;
+    struct scull_p_file *pf = filp->private_data;
+    struct scull_pipe *dev = pf->dev;
     // 表明设备的当前状态
     unsigned int mask = 0;
+    // 调用者关心的事件，只在对应的等待队列上注册，避免无关事件的唤醒
+    __poll_t events = poll_requested_events(wait);
 
     down(&dev->sem);
-    // 注册等待队列
-    poll_wait(filp, &dev->inq, wait);
-    poll_wait(filp, &dev->outq, wait);
-    // 检查是否可读
-    if (dev->rp != dev->wp) mask |= POLLIN | POLLRDNORM;
-    // 检查是否可写
-    if (spacefree(dev)) mask |= POLLOUT | POLLWRNORM;
+    // 注册等待队列。POLLHUP 总是会报告，什么都没有请求的调用者也要挂在读队列上
+    if (events & (EPOLLIN | EPOLLRDNORM | EPOLLRDHUP) ||
+        !(events & (EPOLLOUT | EPOLLWRNORM)))
+        poll_wait(filp, &dev->inq, wait);
+    if (events & (EPOLLOUT | EPOLLWRNORM)) poll_wait(filp, &dev->outq, wait);
+    // 检查是否可读（数据量达到读低水位），写者都已关闭时剩余的数据也可以读取
+    if (scull_p_file_readable(dev, pf, scull_p_rcvlowat(dev)) ||
+        (scull_p_eof(dev) && scull_p_cursor(dev, pf) != dev->wp))
+        mask |= POLLIN | POLLRDNORM;
+    // 检查是否可写（剩余空间达到写低水位）
+    if (scull_p_writable(dev)) mask |= POLLOUT | POLLWRNORM;
+    // 文件尾：读者不会再等到新的数据
+    if ((filp->f_mode & FMODE_READ) && scull_p_eof(dev))
+        mask |= POLLHUP | POLLRDHUP;
     up(&dev->sem);
     return mask;
+}
+
+// 管道专用的 ioctl 命令，其余命令交给 scull_ioctl 统一处理
+long scull_p_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
+    struct scull_p_file *pf = filp->private_data;
+    struct scull_pipe *dev = pf->dev;
+    struct scull_p_batch batch;
+    struct scull_p_eventfd efd;
+    struct eventfd_ctx *rd, *wr;
+    struct scull_p_file *p;
+    int tmp;
 
-    // 缺少了文件尾(end-of-file)的支持和处理
+    switch (cmd) {
+        case SCULL_P_IOCTRCVLOWAT:
+            if (arg < 1 || arg > INT_MAX) return -EINVAL;
+            if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+            dev->rcvlowat = arg;
+            up(&dev->sem);
+            // 水位降低后，可能已经有读者满足条件
+            scull_p_wake_readers(dev);
+            return 0;
+
+        case SCULL_P_IOCQRCVLOWAT:
+            return dev->rcvlowat;
+
+        case SCULL_P_IOCTSNDLOWAT:
+            if (arg < 1 || arg > INT_MAX) return -EINVAL;
+            if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+            dev->sndlowat = arg;
+            up(&dev->sem);
+            scull_p_wake_writers(dev);
+            return 0;
+
+        case SCULL_P_IOCQSNDLOWAT:
+            return dev->sndlowat;
+
+        case SCULL_P_IOCSBATCH:
+            if (copy_from_user(&batch, (void __user *)arg, sizeof(batch)))
+                return -EFAULT;
+            if (batch.vmin < 0 || batch.vtime < 0) return -EINVAL;
+            pf->vmin = batch.vmin;
+            pf->vtime = batch.vtime;
+            return 0;
+
+        case SCULL_P_IOCGBATCH:
+            batch.vmin = pf->vmin;
+            batch.vtime = pf->vtime;
+            if (copy_to_user((void __user *)arg, &batch, sizeof(batch)))
+                return -EFAULT;
+            return 0;
+
+        // 查询缓冲区中可读取的字节数，方便读者准备合适大小的缓冲区
+        case FIONREAD:
+            if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+            tmp = scull_p_avail_at(dev, scull_p_cursor(dev, pf));
+            up(&dev->sem);
+            return put_user(tmp, (int __user *)arg);
+
+        // 设置管道的工作模式，只能在缓冲区为空时切换
+        case SCULL_P_IOCTMODE:
+            if (arg & ~(unsigned long)SCULL_P_MODE_MASK) return -EINVAL;
+            // 越过慢读者只在广播模式下有意义
+            if ((arg & SCULL_P_LAP) && !(arg & SCULL_P_BROADCAST))
+                return -EINVAL;
+            // 只有从不阻塞的覆盖模式才需要按整条记录丢弃
+            if ((arg & SCULL_P_RECORDS) && !(arg & SCULL_P_OVERWRITE))
+                return -EINVAL;
+            if (down_interruptible(&dev->sem)) return -ERESTARTSYS;
+            if (dev->rp != dev->wp) {
+                up(&dev->sem);
+                return -EBUSY;
+            }
+            if ((arg & SCULL_P_RECORDS) && !dev->records) {
+                dev->records =
+                    bitmap_zalloc(dev->buffersize, GFP_KERNEL_ACCOUNT);
+                if (!dev->records) {
+                    up(&dev->sem);
+                    return -ENOMEM;
+                }
+                scull_stat_add(dev->stats, SCULL_STAT_ALLOCS, 1);
+            } else if (!(arg & SCULL_P_RECORDS)) {
+                bitmap_free(dev->records);
+                dev->records = NULL;
+            }
+            dev->flags = arg;
+            // 缓冲区为空，所有读者的游标都从写指针开始
+            list_for_each_entry(p, &dev->readers, list) p->rp = dev->wp;
+            up(&dev->sem);
+            scull_p_wake_writers(dev);
+            return 0;
+
+        case SCULL_P_IOCQMODE:
+            return dev->flags;
+
+        // 注册数据可读和空间可写的 eventfd，文件描述符为负数表示取消注册
+        case SCULL_P_IOCSEVENTFD:
+            if (copy_from_user(&efd, (void __user *)arg, sizeof(efd)))
+                return -EFAULT;
+            rd = efd.rfd >= 0 ? eventfd_ctx_fdget(efd.rfd) : NULL;
+            if (IS_ERR(rd)) return PTR_ERR(rd);
+            wr = efd.wfd >= 0 ? eventfd_ctx_fdget(efd.wfd) : NULL;
+            if (IS_ERR(wr)) {
+                if (rd) eventfd_ctx_put(rd);
+                return PTR_ERR(wr);
+            }
+            down(&dev->sem);
+            scull_p_set_eventfd(dev, rd, wr);
+            up(&dev->sem);
+            return 0;
+
+        // 获得丢失的字节数：广播模式下是本文件因为读得太慢而被越过丢失的字节数，
+        // 否则是整个管道在覆盖模式下丢弃的字节数
+        case SCULL_P_IOCGDROPPED:
+            return put_user(scull_p_broadcast(dev) ? pf->dropped : dev->dropped,
+                            (u64 __user *)arg);
+
+        case SCULL_P_IOCTBUSYPOLL:
+            if (arg > SCULL_P_BUSY_POLL_MAX) return -EINVAL;
+            pf->busy_poll = pf->busy_budget = arg;
+            return 0;
+
+        case SCULL_P_IOCQBUSYPOLL:
+            return pf->busy_poll;
+
+        default:
+            return scull_ioctl(filp, cmd, arg);
+    }
 }
 
 // 管理异步通知队列
 int scull_p_fasync(int fd, struct file *filp, int mode) {
-    struct scull_pipe *dev = filp->private_data;
+    struct scull_pipe *dev = scull_p_dev(filp);
     // mode!=0时，将进程加入队列；mode=0时，从队列中删除进程
     return fasync_helper(fd, filp, mode, &dev->async_queue);
 }
 
+// 内存回收
+// 内存紧张时，shrinker 释放空闲（没有数据）的管道缓冲区，下次写入或打开时再分配；
+// 覆盖模式（飞行记录器）下旧数据本来就是可以丢弃的，直接丢弃全部数据后释放缓冲区，计入丢弃计数
+
+// 缓冲区是否可以回收，调用者持有互斥锁或者只是估计
+static bool scull_p_reclaimable(struct scull_pipe *dev) {
+    return dev->buffer &&
+           (dev->rp == dev->wp || (dev->flags & SCULL_P_OVERWRITE));
+}
+
+static unsigned long scull_p_shrink_count(struct shrinker *shrink,
+                                          struct shrink_control *sc) {
+    unsigned long count = 0;
+    int i;
+
+    for (i = 0; i < scull_p_nr_devs; i++)
+        if (scull_p_reclaimable(scull_p_devices + i)) count++;
+    return count;
+}
+
+static unsigned long scull_p_shrink_scan(struct shrinker *shrink,
+                                         struct shrink_control *sc) {
+    struct scull_pipe *dev;
+    unsigned long freed = 0;
+    int i;
+
+    for (i = 0; i < scull_p_nr_devs && freed < sc->nr_to_scan; i++) {
+        dev = scull_p_devices + i;
+        // 读写路径持有互斥锁时可能正在分配内存并触发回收，这里不能等待，否则会死锁
+        if (down_trylock(&dev->sem)) continue;
+        if (scull_p_reclaimable(dev)) {
+            if (dev->rp != dev->wp) scull_p_discard(dev, scull_p_avail(dev));
+            scull_p_free_buffer(dev);
+            scull_stat_add(dev->stats, SCULL_STAT_RECLAIM, dev->buffersize);
+            freed++;
+        }
+        up(&dev->sem);
+    }
+    return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker scull_p_shrinker = {
+    .count_objects = scull_p_shrink_count,
+    .scan_objects = scull_p_shrink_scan,
+    .seeks = DEFAULT_SEEKS,
+};
+
 static void scull_p_setup_cdev(struct scull_pipe *dev, int index) {
     int err, devno = scull_p_devno + index;
 
@@ -233,6 +1082,7 @@ static void scull_p_setup_cdev(struct scull_pipe *dev, int index) {
 // 初始化管道设备，返回管道设备数量
 int scull_p_init(dev_t firstdev) {
     int i, result;
+    char name[24];  // "scullpipe" 加上任意的 int
 
     // 分配设备编号
     result = register_chrdev_region(firstdev, scull_p_nr_devs, "scullp");
@@ -252,14 +1102,35 @@ int scull_p_init(dev_t firstdev) {
     }
     memset(scull_p_devices, 0, scull_p_nr_devs * sizeof(struct scull_pipe));
 
+    // 分配统计计数器
+    for (i = 0; i < scull_p_nr_devs; i++) {
+        scull_p_devices[i].stats = alloc_percpu(struct scull_stats);
+        if (!scull_p_devices[i].stats) {
+            while (i--) free_percpu(scull_p_devices[i].stats);
+            kfree(scull_p_devices);
+            scull_p_devices = NULL;
+            unregister_chrdev_region(firstdev, scull_p_nr_devs);
+            return 0;
+        }
+    }
+
     // 初始化结构体
     for (i = 0; i < scull_p_nr_devs; i++) {
+        snprintf(name, sizeof(name), "scullpipe%d", i);
+        scull_stats_register(name, scull_p_devices[i].stats);
         init_waitqueue_head(&(scull_p_devices[i].inq));
         init_waitqueue_head(&(scull_p_devices[i].outq));
+        INIT_LIST_HEAD(&scull_p_devices[i].handoffs);
+        INIT_LIST_HEAD(&scull_p_devices[i].readers);
         sema_init(&scull_p_devices[i].sem, 1);
+        scull_p_devices[i].rcvlowat = scull_p_devices[i].sndlowat = 1;
         scull_p_setup_cdev(scull_p_devices + i, i);
     }
 
+    // 注册失败只是不能回收空闲的缓冲区，不影响管道的使用
+    if (register_shrinker(&scull_p_shrinker))
+        printk(KERN_NOTICE "Unable to register scullpipe shrinker\n");
+
     return scull_p_nr_devs;
 }
 
@@ -269,9 +1140,13 @@ void scull_p_cleanup(void) {
 
     if (!scull_p_devices) return;
 
+    unregister_shrinker(&scull_p_shrinker);
     for (i = 0; i < scull_p_nr_devs; i++) {
         cdev_del(&scull_p_devices[i].cdev);
         kfree(scull_p_devices[i].buffer);
+        bitmap_free(scull_p_devices[i].records);
+        scull_p_set_eventfd(scull_p_devices + i, NULL, NULL);
+        free_percpu(scull_p_devices[i].stats);
     }
     kfree(scull_p_devices);
     unregister_chrdev_region(scull_p_devno, scull_p_nr_devs);
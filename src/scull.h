@@ -2,8 +2,15 @@
 #define SCULL_H
 
 #include <linux/cdev.h>
+#include <linux/err.h>
+#include <linux/jump_label.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
 #include <linux/poll.h>
+#include <linux/sched/clock.h>
 #include <linux/semaphore.h>
+#include <linux/uio.h>
+#include <linux/workqueue.h>
 
 #ifndef SCULL_MAJOR
 #define SCULL_MAJOR 0  // 默认动态分配
@@ -29,37 +36,241 @@
 #define SCULL_QSET 1024
 #endif
 
+// 统计计数器（stats.c），每个 CPU 一份，更新时不需要加锁，读取时再把各个 CPU 的值加起来
+enum scull_stat_item {
+    SCULL_STAT_READS,         // 读操作次数
+    SCULL_STAT_WRITES,        // 写操作次数
+    SCULL_STAT_READ_BYTES,    // 读取的字节数
+    SCULL_STAT_WRITE_BYTES,   // 写入的字节数
+    SCULL_STAT_SHORT_READS,   // 读取的字节数少于请求的次数
+    SCULL_STAT_SHORT_WRITES,  // 写入的字节数少于请求的次数
+    SCULL_STAT_EAGAIN,        // 返回 -EAGAIN 的次数
+    SCULL_STAT_ALLOCS,        // 内存分配次数
+    SCULL_STAT_LOCK_WAIT,     // 等待互斥锁的总时间（纳秒）
+    SCULL_STAT_COMPRESS,      // 压缩的量子数量
+    SCULL_STAT_DECOMPRESS,    // 解压的量子数量
+    SCULL_STAT_ZERO,          // 因为全零而释放或者没有分配的量子数量
+    SCULL_STAT_DEDUP,         // 和已有量子内容相同而共享的次数
+    SCULL_STAT_COW,           // 写入共享量子时复制的次数
+    SCULL_STAT_RECLAIM,       // 内存紧张时回收的字节数
+    SCULL_STAT_WRITEBACK,     // 写回后备文件的量子数量
+    SCULL_STAT_REMAP,         // 设备间拷贝时共享而没有复制的量子数量
+    SCULL_STAT_CACHE_HIT,     // 缓存模式下读到数据的次数
+    SCULL_STAT_CACHE_MISS,    // 缓存模式下读到空洞或者过期量子的次数
+    SCULL_STAT_CACHE_EVICT,   // 缓存模式下因为预算或者内存紧张淘汰的量子数量
+    SCULL_STAT_CACHE_EXPIRE,  // 缓存模式下因为过期淘汰的量子数量
+    SCULL_STAT_NR,
+};
+
+// 延迟直方图
+enum scull_hist_item {
+    SCULL_HIST_READ,   // 读操作耗时
+    SCULL_HIST_WRITE,  // 写操作耗时
+    SCULL_HIST_SLEEP,  // 读者、写者等待数据或空间时的睡眠时间
+    SCULL_HIST_DECOMPRESS,  // 访问被压缩的量子时的解压时间
+    SCULL_HIST_NR,
+};
+
+// 直方图按 2 的幂分桶：第 i 个桶统计 [2^i, 2^(i+1)) 纳秒，最后一个桶包含所有更长的时间
+#define SCULL_HIST_BUCKETS 32
+
+struct scull_stats {
+    u64 count[SCULL_STAT_NR];
+    u64 hist[SCULL_HIST_NR][SCULL_HIST_BUCKETS];
+};
+
+// 统计开关，默认打开，可以通过 debugfs 的 scull/stats_enabled 关闭。
+// 使用静态键，关闭后统计代码只剩一条不跳转的空指令
+DECLARE_STATIC_KEY_TRUE(scull_stats_key);
+
+static inline bool scull_stats_on(void) {
+    return static_branch_likely(&scull_stats_key);
+}
+
+static inline void scull_stat_add(struct scull_stats __percpu *stats,
+                                  enum scull_stat_item item, u64 val) {
+    if (scull_stats_on()) this_cpu_add(stats->count[item], val);
+}
+
+// 记录一次耗时（纳秒）
+static inline void scull_stat_time(struct scull_stats __percpu *stats,
+                                   enum scull_hist_item hist, u64 ns) {
+    if (scull_stats_on())
+        this_cpu_inc(
+            stats->hist[hist][min_t(int, ilog2(ns | 1), SCULL_HIST_BUCKETS - 1)]);
+}
+
+// 记录一次读写操作的结果，count 是请求的字节数，ret 是返回值，ns 是耗时
+static inline void scull_stat_io(struct scull_stats __percpu *stats, bool write,
+                                 size_t count, ssize_t ret, u64 ns) {
+    scull_stat_add(stats, write ? SCULL_STAT_WRITES : SCULL_STAT_READS, 1);
+    if (ret > 0)
+        scull_stat_add(stats, write ? SCULL_STAT_WRITE_BYTES : SCULL_STAT_READ_BYTES,
+                       ret);
+    if (ret >= 0 && (size_t)ret < count)
+        scull_stat_add(stats, write ? SCULL_STAT_SHORT_WRITES : SCULL_STAT_SHORT_READS,
+                       1);
+    if (ret == -EAGAIN) scull_stat_add(stats, SCULL_STAT_EAGAIN, 1);
+    scull_stat_time(stats, write ? SCULL_HIST_WRITE : SCULL_HIST_READ, ns);
+}
+
+void scull_stats_init(void);
+void scull_stats_cleanup(void);
+void scull_stats_register(const char *name, struct scull_stats __percpu *stats);
+
+// 内容相同的量子共享同一块内存（dedup.c）
+struct scull_shared {
+    struct hlist_node node;  // 链接到全局的哈希表
+    unsigned int ref;        // 引用计数，由 dedup.c 的全局锁保护
+    u32 hash;                // 内容的哈希值
+    int len;                 // 量子大小
+    void *data;              // 共享的内容，共享期间不会被修改
+};
+
+// 每个量子的元数据，和 qset 的 data 数组一一对应
+struct scull_qmeta {
+    unsigned long atime;  // 最近一次访问的时间（jiffies），用于判断冷数据
+    unsigned int zlen;    // 压缩后的长度，0 表示没有压缩
+    unsigned int flags;   // SCULL_Q_*
+    struct scull_shared *shared;  // 不为 NULL 时 data[i] 指向共享的内容，写入前需要复制
+    struct list_head lru;     // 缓存模式下链接到设备的 LRU 链表，next 为 NULL 表示不在链表中
+    struct scull_qset *qs;    // 所在的量子集合，淘汰时使用
+};
+
+// 压缩效果不好，重新写入之前不再尝试压缩
+#define SCULL_Q_INCOMPRESSIBLE 0x1
+// 内容还没有写回后备文件，写回之前不压缩
+#define SCULL_Q_DIRTY 0x2
+
 struct scull_qset {
-    void **data;              // 数据实际保存位置
-    struct scull_qset *next;  // 指向下一个 qset
+    void **data;               // 数据实际保存位置
+    struct scull_qmeta *meta;  // 每个量子的元数据，和 data 同时分配
+    struct scull_qset *next;   // 指向下一个 qset
 };
 
 // 每个内存区域称为 quantum
 // 由 quantum 组成的数组称为 qset
 struct scull_dev {
     struct scull_qset *data;  // 保存数据的头结点
+    struct scull_qset *cur;   // scull_follow 上一次定位到的量子集合
+    int cur_item;             // cur 在链表中的序号
     int quantum;              // 每个量子中可以存储的数据字节数
     int qset;                 // 当前保存的量子数量
     unsigned long size;       // 当前设备存储的数据总量
     unsigned int access_key;  // 用于访问控制
+    unsigned int compress_ms;  // 量子多久没有访问后压缩（毫秒），0 表示不压缩
+    bool dedup;               // 写满的量子是否和内容相同的量子共享
+    unsigned long limit;      // 已分配量子的字节数上限，0 表示不限制
+    unsigned long allocated;  // 已分配量子的字节数（共享和压缩的量子按完整的量子计算）
+    struct file *backing;     // 后备文件，NULL 表示没有绑定
+    loff_t wb_trunc;          // 后备文件需要先截断到的长度，-1 表示不需要
+    struct delayed_work wb_work;  // 后台写回
+    struct scull_kv_table *kv;    // 键值存储，第一次写入时创建
+    bool cache;                   // 缓存模式
+    unsigned int cache_ttl;       // 量子多久没有访问就过期（毫秒），0 表示不过期
+    unsigned long cache_budget;   // 缓存占用内存的预算（字节），0 表示不限制
+    unsigned long cache_nr;       // LRU 链表中的量子数量
+    struct list_head lru;         // 缓存模式下的量子，最久没有访问的在前
+    struct list_head cache_node;  // 链接到缓存模式设备的全局链表，供内存回收使用
+    struct delayed_work cache_work;  // 后台淘汰
     struct semaphore sem;     // 互斥锁
+    struct scull_stats __percpu *stats;  // 统计计数器
     // scull 的做法是把 cdev 结构嵌入到 scull 设备结构体中
     struct cdev cdev;  // 字符设备结构体
 };
 
 struct scull_qset *scull_follow(struct scull_dev *dev, int n);
 int scull_trim(struct scull_dev *dev);
+struct scull_qset *scull_locate(struct scull_dev *dev, loff_t pos, int *s_pos);
+void *scull_qalloc(struct scull_dev *dev);
+void scull_qfree(struct scull_dev *dev, struct scull_qset *dptr, int i);
+ssize_t scull_read_locked(struct scull_dev *dev, loff_t pos,
+                          struct iov_iter *to);
+ssize_t scull_write_locked(struct scull_dev *dev, loff_t pos,
+                           struct iov_iter *from);
+
+extern struct scull_dev *scull_devices;
+extern int scull_nr_devs;
+extern int scull_quantum, scull_qset;
+extern unsigned long scull_limit;
+
+// 冷量子压缩（compress.c）
+int scull_zload(struct scull_dev *dev, struct scull_qset *dptr, int i);
+void scull_zset(struct scull_dev *dev, unsigned int ms);
+int scull_zinit(void);
+void scull_zcleanup(void);
+
+// 量子去重（dedup.c）
+void scull_dedup(struct scull_dev *dev, struct scull_qset *dptr, int i);
+int scull_unshare(struct scull_dev *dev, struct scull_qset *dptr, int i);
+void scull_shared_get(struct scull_shared *sh);
+void scull_shared_put(struct scull_shared *sh);
+void scull_dedup_summary(unsigned long *buffers, unsigned long *refs);
+
+// 后备文件的异步写回（backing.c）
+void scull_wb_dirty(struct scull_dev *dev, struct scull_qmeta *m);
+void scull_wb_truncate(struct scull_dev *dev);
+int scull_wb_bind(struct scull_dev *dev, int fd);
+int scull_wb_flush(struct scull_dev *dev);
+void scull_wb_init(struct scull_dev *dev);
+void scull_wb_cleanup(struct scull_dev *dev);
+
+// 设备之间的拷贝（copy.c）
+struct scull_copy;
+long scull_copy(struct file *filp, struct scull_copy *c);
+
+// 批量读写（batch.c）
+struct scull_batch;
+long scull_batch(struct file *filp, struct scull_batch *b);
+
+// 键值存储（kv.c）
+struct scull_kv;
+long scull_kv_ioctl(struct file *filp, unsigned int cmd,
+                    struct scull_kv __user *arg);
+void scull_kv_clear(struct scull_dev *dev);
+
+// 缓存模式（cache.c）
+struct scull_cache;
+void scull_cache_touch(struct scull_dev *dev, struct scull_qset *dptr, int i);
+bool scull_cache_expire(struct scull_dev *dev, struct scull_qset *dptr, int i);
+void scull_cache_make_room(struct scull_dev *dev);
+int scull_cache_set(struct scull_dev *dev, struct scull_cache *c);
+void scull_cache_get(struct scull_dev *dev, struct scull_cache *c);
+void scull_cache_setup(struct scull_dev *dev);
+void scull_cache_release(struct scull_dev *dev);
+void scull_cache_init(void);
+void scull_cache_exit(void);
+
+// 获取设备的互斥锁
+// IOCB_NOWAIT 的请求（io_uring 内联提交、preadv2/pwritev2 的 RWF_NOWAIT）不允许睡眠，
+// 此时只尝试加锁，拿不到锁就返回 -EAGAIN，由调用者稍后重试。
+// 没有竞争时直接拿到锁，只有需要等待时才读取时钟统计等待时间
+static inline int scull_down(struct semaphore *sem, struct kiocb *iocb,
+                             struct scull_stats __percpu *stats) {
+    u64 start;
+
+    if (!down_trylock(sem)) return 0;
+    if (iocb->ki_flags & IOCB_NOWAIT) return -EAGAIN;
+    start = local_clock();
+    if (down_interruptible(sem)) return -ERESTARTSYS;
+    scull_stat_add(stats, SCULL_STAT_LOCK_WAIT, local_clock() - start);
+    return 0;
+}
 
 // 文件操作集
 
 loff_t scull_llseek(struct file *filp, loff_t off, int whence);
-ssize_t scull_read(struct file *filp, char __user *buf, size_t count,
-                   loff_t *f_pos);
-ssize_t scull_write(struct file *filp, const char __user *buf, size_t count,
-                    loff_t *f_pos);
+ssize_t scull_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t scull_write_iter(struct kiocb *iocb, struct iov_iter *from);
 long scull_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 int scull_open(struct inode *inode, struct file *filp);
 int scull_release(struct inode *inode, struct file *filp);
+int scull_fsync(struct file *filp, loff_t start, loff_t end, int datasync);
+
+// 文件是否是 scull 设备，包括 access.c 中的私有设备，而不是管道
+static inline bool scull_is_dev(struct file *filp) {
+    return filp->f_op->read_iter == scull_read_iter;
+}
 
 // ioctl 定义
 
@@ -110,7 +321,156 @@ int scull_release(struct inode *inode, struct file *filp);
 // 获得当前的SCULL_P_BUFFER值（通过返回值）
 #define SCULL_P_IOCQSIZE _IO(SCULL_IOC_MAGIC, 14)
 
-#define SCULL_IOC_MAXNR 14
+// 以下是作用于单个管道的 ioctl 命令，由 scull_p_ioctl 处理
+// 设置读低水位（通过直接变量），数据量达到该值才唤醒读者、报告可读、发送 SIGIO
+#define SCULL_P_IOCTRCVLOWAT _IO(SCULL_IOC_MAGIC, 15)
+// 获得读低水位（通过返回值）
+#define SCULL_P_IOCQRCVLOWAT _IO(SCULL_IOC_MAGIC, 16)
+// 设置写低水位（通过直接变量），剩余空间达到该值才唤醒写者、报告可写
+#define SCULL_P_IOCTSNDLOWAT _IO(SCULL_IOC_MAGIC, 17)
+// 获得写低水位（通过返回值）
+#define SCULL_P_IOCQSNDLOWAT _IO(SCULL_IOC_MAGIC, 18)
+
+// 批量读取参数，作用于单个打开的文件，含义类似终端的 VMIN/VTIME
+struct scull_p_batch {
+    int vmin;   // 阻塞读至少凑够的字节数，0 或 1 表示有数据就返回
+    int vtime;  // 拿到第一批数据后最多再等待的毫秒数，0 表示一直等到凑够 vmin
+};
+
+// 设置批量读取参数（通过指针）
+#define SCULL_P_IOCSBATCH _IOW(SCULL_IOC_MAGIC, 19, struct scull_p_batch)
+// 获得批量读取参数（通过指针）
+#define SCULL_P_IOCGBATCH _IOR(SCULL_IOC_MAGIC, 20, struct scull_p_batch)
+// 设置读者的忙等预算，单位微秒（通过直接变量），作用于单个打开的文件
+#define SCULL_P_IOCTBUSYPOLL _IO(SCULL_IOC_MAGIC, 21)
+// 获得读者的忙等预算（通过返回值）
+#define SCULL_P_IOCQBUSYPOLL _IO(SCULL_IOC_MAGIC, 22)
+
+// 管道的工作模式
+// 广播模式：每个读者有自己的读游标，每个字节都会交给所有读者，写者只受最慢的读者限制
+#define SCULL_P_BROADCAST 0x1
+// 越过慢读者（只用于广播模式）：写者从不阻塞，空间不够时丢弃最旧的数据，慢读者丢失这部分数据
+#define SCULL_P_LAP 0x2
+// 覆盖模式（飞行记录器）：写者从不阻塞，缓冲区满时丢弃最旧的数据并计入丢弃计数
+#define SCULL_P_OVERWRITE 0x4
+// 记录模式（只用于覆盖模式）：每次写入是一条完整的记录，丢弃时按整条记录丢弃
+#define SCULL_P_RECORDS 0x8
+#define SCULL_P_MODE_MASK \
+    (SCULL_P_BROADCAST | SCULL_P_LAP | SCULL_P_OVERWRITE | SCULL_P_RECORDS)
+
+// 设置管道的工作模式（通过直接变量），缓冲区不为空时返回 -EBUSY
+#define SCULL_P_IOCTMODE _IO(SCULL_IOC_MAGIC, 23)
+// 获得管道的工作模式（通过返回值）
+#define SCULL_P_IOCQMODE _IO(SCULL_IOC_MAGIC, 24)
+// 获得丢失的字节数（通过指针）：广播模式下是本文件的，否则是整个管道的
+#define SCULL_P_IOCGDROPPED _IOR(SCULL_IOC_MAGIC, 25, __u64)
+
+// 管道的 eventfd 通知，只在状态变化时触发：
+// 数据量从读低水位以下变为达到读低水位时通知 rfd，剩余空间从写低水位以下变为达到写低水位时通知 wfd
+struct scull_p_eventfd {
+    int rfd;  // 数据可读通知，负数表示不注册
+    int wfd;  // 空间可写通知，负数表示不注册
+};
+
+// 注册 eventfd（通过指针），替换之前注册的 eventfd
+#define SCULL_P_IOCSEVENTFD _IOW(SCULL_IOC_MAGIC, 26, struct scull_p_eventfd)
+
+// 以下是作用于单个 scull 设备的 ioctl 命令
+// 设置冷量子压缩的时间（通过直接变量），单位毫秒，量子这么久没有被访问就在后台压缩，0 表示关闭
+#define SCULL_IOCTCOMPRESS _IO(SCULL_IOC_MAGIC, 27)
+// 获得冷量子压缩的时间（通过返回值）
+#define SCULL_IOCQCOMPRESS _IO(SCULL_IOC_MAGIC, 28)
+// 打开或关闭量子去重（通过直接变量），打开后写满的量子和内容相同的量子共享内存，写入时复制
+#define SCULL_IOCTDEDUP _IO(SCULL_IOC_MAGIC, 29)
+// 获得量子去重是否打开（通过返回值）
+#define SCULL_IOCQDEDUP _IO(SCULL_IOC_MAGIC, 30)
+// 设置设备的内存上限（通过直接变量），单位字节，0 表示不限制，超过上限的写入返回 -ENOSPC
+#define SCULL_IOCTLIMIT _IO(SCULL_IOC_MAGIC, 31)
+// 获得设备的内存上限（通过返回值）
+#define SCULL_IOCQLIMIT _IO(SCULL_IOC_MAGIC, 32)
+// 绑定后备文件（通过直接变量传入打开的文件描述符），负数表示解除绑定
+// 绑定时先清空设备，再从文件加载内容，之后修改过的量子在后台批量写回文件
+#define SCULL_IOCTBACKING _IO(SCULL_IOC_MAGIC, 33)
+// 立即写回所有修改过的量子并同步后备文件，返回写回过程中遇到的错误
+#define SCULL_IOCFLUSH _IO(SCULL_IOC_MAGIC, 34)
+
+// 从另一个 scull 设备拷贝一段数据到本设备
+// 两边的偏移量都在量子边界上、量子大小相同时，整个量子通过共享完成，不复制数据，之后写入时再复制
+struct scull_copy {
+    int src_fd;      // 源设备的文件描述符，可以和目标是同一个设备，但范围不能重叠
+    __u32 flags;     // SCULL_COPY_*
+    __u64 src_off;   // 源设备的偏移量
+    __u64 dst_off;   // 本设备的偏移量
+    __u64 len;       // 拷贝的字节数，超过源设备数据末尾的部分被忽略
+};
+
+// 只共享不复制：偏移量和长度不在量子边界上时返回 -EINVAL，类似 FICLONERANGE
+#define SCULL_COPY_REMAP 0x1
+
+// 拷贝数据（通过指针），返回拷贝的字节数
+#define SCULL_IOCCOPY _IOW(SCULL_IOC_MAGIC, 35, struct scull_copy)
+
+// 批量读写中的一项，和 pread/pwrite 相同，但可以跨越量子，直到读到数据末尾或者写完
+struct scull_io {
+    __u64 off;     // 设备的偏移量
+    __u64 buf;     // 用户缓冲区的地址
+    __u32 len;     // 字节数
+    __u32 flags;   // SCULL_IO_*，其他位保留，置位时这一项返回 -EINVAL
+    __s64 result;  // 返回：读写的字节数，一个字节都没有读写时是负的错误码
+};
+
+// 写入，否则是读取
+#define SCULL_IO_WRITE 0x1
+
+struct scull_batch {
+    __u64 ios;  // struct scull_io 数组的地址
+    __u32 nr;   // 数组的长度，不超过 SCULL_BATCH_MAX
+    __u32 pad;  // 必须为 0
+};
+
+#define SCULL_BATCH_MAX 1024
+
+// 在一次加锁中按偏移量顺序执行一组读写（通过指针），结果写回每一项的 result，
+// 返回执行了的项数。偏移量相同的项按数组中的顺序执行
+#define SCULL_IOCBATCH _IOW(SCULL_IOC_MAGIC, 36, struct scull_batch)
+
+// 键值存储的一次操作
+// 每个设备除了字节流之外还有一个键值存储，清空设备时保留，设备销毁时释放，不写回后备文件
+struct scull_kv {
+    __u64 key;   // 键的地址
+    __u64 val;   // 值的地址
+    __u32 klen;  // 键的长度，1 到 SCULL_KV_KEY_MAX
+    __u32 vlen;  // 值的长度；读取时传入缓冲区的大小，返回值的实际长度
+};
+
+#define SCULL_KV_KEY_MAX 256
+#define SCULL_KV_VAL_MAX (1 << 20)
+
+// 写入一个键值对（通过指针），键已经存在时替换原来的值
+#define SCULL_IOCKVPUT _IOW(SCULL_IOC_MAGIC, 37, struct scull_kv)
+// 读取一个键的值（通过指针），返回值的长度；缓冲区不够大时返回 -ERANGE，vlen 是需要的大小
+#define SCULL_IOCKVGET _IOWR(SCULL_IOC_MAGIC, 38, struct scull_kv)
+// 删除一个键（通过指针），键不存在时返回 -ENOENT
+#define SCULL_IOCKVDEL _IOW(SCULL_IOC_MAGIC, 39, struct scull_kv)
+
+// 缓存模式的参数
+// 缓存模式下量子按访问时间排在 LRU 链表中，过期的量子和超出预算时最久没有访问的量子被淘汰，
+// 内存紧张时也会被回收。读到被淘汰的量子（或者从来没有写过的空洞）返回 -ENODATA，表示缓存没有命中
+struct scull_cache {
+    __u32 flags;   // SCULL_CACHE_*
+    __u32 ttl_ms;  // 量子多久没有访问就过期，0 表示不过期
+    __u64 budget;  // 设备占用内存的预算（字节），0 表示不限制
+};
+
+// 打开缓存模式，只能在设备为空时打开或关闭，否则返回 -EBUSY
+#define SCULL_CACHE_ON 0x1
+
+// 设置缓存模式（通过指针）
+#define SCULL_IOCSCACHE _IOW(SCULL_IOC_MAGIC, 40, struct scull_cache)
+// 获得缓存模式（通过指针）
+#define SCULL_IOCGCACHE _IOR(SCULL_IOC_MAGIC, 41, struct scull_cache)
+
+#define SCULL_IOC_MAXNR 41
 
 #ifndef SCULL_P_NR_DEVS
 #define SCULL_P_NR_DEVS 4
@@ -120,28 +480,58 @@ int scull_release(struct inode *inode, struct file *filp);
 #define SCULL_P_BUFFER 4096
 #endif
 
+// 忙等预算的上限（微秒），避免读者长时间占用 CPU
+#ifndef SCULL_P_BUSY_POLL_MAX
+#define SCULL_P_BUSY_POLL_MAX 10000
+#endif
+
 struct scull_pipe {
     wait_queue_head_t inq, outq;        // 读者和写者的等待队列头
     char *buffer, *end;                 // 缓冲区的起始和终止位置
     int buffersize;                     // 缓冲区大小，用于指针计算
     char *rp, *wp;                      // 缓冲区当前读写位置
     int nreaders, nwriters;             // 读者和写者的数量
+    bool had_writer;                    // 曾经有写者打开过，之后写者全部关闭即为文件尾
+    int rcvlowat, sndlowat;             // 读、写低水位
+    atomic_t rd_short, wr_short;        // 等待量小于低水位的阻塞读者、写者数量
+    int flags;                          // 工作模式，SCULL_P_BROADCAST 等
+    unsigned long *records;             // 记录模式下每条记录起点的位图
+    u64 dropped;                        // 覆盖模式下丢弃的字节数
+    struct list_head readers;           // 所有以读方式打开的文件
+    struct list_head handoffs;          // 等待写者直接交接数据的读者
     struct fasync_struct *async_queue;  // 异步队列
+    struct eventfd_ctx *rd_evfd;        // 数据可读时通知的 eventfd
+    struct eventfd_ctx *wr_evfd;        // 空间可写时通知的 eventfd
     struct semaphore sem;               // 互斥锁
+    struct scull_stats __percpu *stats;  // 统计计数器
     struct cdev cdev;                   // 字符设备
 };
 
+// 每个打开的管道文件各自的状态，保存在 filp->private_data 中
+struct scull_p_file {
+    struct scull_pipe *dev;  // 所属的管道设备
+    struct list_head list;   // 以读方式打开时链接到 dev->readers
+    char *rp;                // 广播模式下自己的读游标
+    u64 dropped;             // 广播模式下被写者越过而丢失的字节数
+    int vmin, vtime;         // 批量读取参数，见 struct scull_p_batch
+    int busy_poll;           // 忙等预算的设置值（微秒）
+    int busy_budget;         // 自适应调整后当前的忙等预算（微秒）
+};
+
 extern int scull_p_buffer;
 
 int scull_p_init(dev_t dev);
 void scull_p_cleanup(void);
 
+// 访问控制的设备变体（access.c）
+int scull_access_init(dev_t dev);
+void scull_access_cleanup(void);
+
 int scull_p_open(struct inode *inode, struct file *filp);
 int scull_p_release(struct inode *inode, struct file *filp);
-ssize_t scull_p_read(struct file *filp, char __user *buf, size_t count,
-                     loff_t *f_pos);
-ssize_t scull_p_write(struct file *filp, const char __user *buf, size_t count,
-                      loff_t *f_pos);
+ssize_t scull_p_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t scull_p_write_iter(struct kiocb *iocb, struct iov_iter *from);
 unsigned int scull_p_poll(struct file *filp, poll_table *wait);
+long scull_p_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 int scull_p_fasync(int fd, struct file *filp, int mode);
 #endif
\ No newline at end of file
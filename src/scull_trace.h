@@ -0,0 +1,156 @@
+// scull 的跟踪点，可以通过 perf、bpftrace 或者 /sys/kernel/tracing/events/scull 使用
+// 例如：perf record -e 'scull:*' -a
+//       bpftrace -e 'tracepoint:scull:scull_read { @ns = hist(args->duration); }'
+// 跟踪点本身由静态键控制，关闭时只是一条不跳转的空指令
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM scull
+
+#if !defined(_SCULL_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _SCULL_TRACE_H
+
+#include <linux/kdev_t.h>
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+// 打开和关闭文件
+DECLARE_EVENT_CLASS(scull_file,
+    TP_PROTO(dev_t dev, fmode_t mode),
+    TP_ARGS(dev, mode),
+
+    TP_STRUCT__entry(
+        __field(dev_t, dev)
+        __field(unsigned int, mode)
+    ),
+
+    TP_fast_assign(
+        __entry->dev = dev;
+        __entry->mode = (__force unsigned int)mode;
+    ),
+
+    TP_printk("dev=%d:%d mode=%s%s",
+              MAJOR(__entry->dev), MINOR(__entry->dev),
+              __entry->mode & (__force unsigned int)FMODE_READ ? "r" : "",
+              __entry->mode & (__force unsigned int)FMODE_WRITE ? "w" : "")
+);
+
+DEFINE_EVENT(scull_file, scull_open,
+    TP_PROTO(dev_t dev, fmode_t mode),
+    TP_ARGS(dev, mode)
+);
+
+DEFINE_EVENT(scull_file, scull_release,
+    TP_PROTO(dev_t dev, fmode_t mode),
+    TP_ARGS(dev, mode)
+);
+
+// 读写操作：偏移量、请求的字节数、返回值和耗时（纳秒）
+DECLARE_EVENT_CLASS(scull_rw,
+    TP_PROTO(dev_t dev, loff_t pos, size_t count, ssize_t ret, u64 duration),
+    TP_ARGS(dev, pos, count, ret, duration),
+
+    TP_STRUCT__entry(
+        __field(dev_t, dev)
+        __field(loff_t, pos)
+        __field(size_t, count)
+        __field(ssize_t, ret)
+        __field(u64, duration)
+    ),
+
+    TP_fast_assign(
+        __entry->dev = dev;
+        __entry->pos = pos;
+        __entry->count = count;
+        __entry->ret = ret;
+        __entry->duration = duration;
+    ),
+
+    TP_printk("dev=%d:%d pos=%lld count=%zu ret=%zd duration=%llu",
+              MAJOR(__entry->dev), MINOR(__entry->dev), __entry->pos,
+              __entry->count, __entry->ret, __entry->duration)
+);
+
+DEFINE_EVENT(scull_rw, scull_read,
+    TP_PROTO(dev_t dev, loff_t pos, size_t count, ssize_t ret, u64 duration),
+    TP_ARGS(dev, pos, count, ret, duration)
+);
+
+DEFINE_EVENT(scull_rw, scull_write,
+    TP_PROTO(dev_t dev, loff_t pos, size_t count, ssize_t ret, u64 duration),
+    TP_ARGS(dev, pos, count, ret, duration)
+);
+
+// 释放设备的数据区，size 是释放前的数据量
+TRACE_EVENT(scull_trim,
+    TP_PROTO(dev_t dev, unsigned long size),
+    TP_ARGS(dev, size),
+
+    TP_STRUCT__entry(
+        __field(dev_t, dev)
+        __field(unsigned long, size)
+    ),
+
+    TP_fast_assign(
+        __entry->dev = dev;
+        __entry->size = size;
+    ),
+
+    TP_printk("dev=%d:%d size=%lu", MAJOR(__entry->dev), MINOR(__entry->dev),
+              __entry->size)
+);
+
+// 管道的读者或写者睡眠等待数据或空间，duration 是睡眠时间（纳秒），ret 非零表示被信号打断
+TRACE_EVENT(scull_wait,
+    TP_PROTO(dev_t dev, bool writer, u64 duration, int ret),
+    TP_ARGS(dev, writer, duration, ret),
+
+    TP_STRUCT__entry(
+        __field(dev_t, dev)
+        __field(bool, writer)
+        __field(u64, duration)
+        __field(int, ret)
+    ),
+
+    TP_fast_assign(
+        __entry->dev = dev;
+        __entry->writer = writer;
+        __entry->duration = duration;
+        __entry->ret = ret;
+    ),
+
+    TP_printk("dev=%d:%d %s duration=%llu ret=%d",
+              MAJOR(__entry->dev), MINOR(__entry->dev),
+              __entry->writer ? "writer" : "reader", __entry->duration,
+              __entry->ret)
+);
+
+// 唤醒管道的读者或写者，events 是唤醒携带的事件掩码
+TRACE_EVENT(scull_wakeup,
+    TP_PROTO(dev_t dev, bool writer, unsigned int events),
+    TP_ARGS(dev, writer, events),
+
+    TP_STRUCT__entry(
+        __field(dev_t, dev)
+        __field(bool, writer)
+        __field(unsigned int, events)
+    ),
+
+    TP_fast_assign(
+        __entry->dev = dev;
+        __entry->writer = writer;
+        __entry->events = events;
+    ),
+
+    TP_printk("dev=%d:%d %s events=%#x",
+              MAJOR(__entry->dev), MINOR(__entry->dev),
+              __entry->writer ? "writers" : "readers", __entry->events)
+);
+
+#endif  // _SCULL_TRACE_H
+
+// 跟踪点头文件不在内核源码树中，需要告诉 define_trace.h 到哪里找它（见 Makefile 的 ccflags-y）
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE scull_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,140 @@
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "scull.h"
+
+// 统计信息通过 debugfs 导出，每个设备一个目录：
+// /sys/kernel/debug/scull/<设备名>/stats  读取计数器和直方图
+// /sys/kernel/debug/scull/<设备名>/reset  写入任意内容清零
+// /sys/kernel/debug/scull/stats_enabled   写入 0 关闭统计，写入 1 打开
+
+static struct dentry *scull_debugfs_root;
+
+DEFINE_STATIC_KEY_TRUE(scull_stats_key);
+
+static int scull_stats_enabled_get(void *data, u64 *val) {
+    *val = scull_stats_on();
+    return 0;
+}
+
+static int scull_stats_enabled_set(void *data, u64 val) {
+    if (val)
+        static_branch_enable(&scull_stats_key);
+    else
+        static_branch_disable(&scull_stats_key);
+    return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(scull_stats_enabled_fops, scull_stats_enabled_get,
+                         scull_stats_enabled_set, "%llu\n");
+
+static const char *const scull_stat_names[SCULL_STAT_NR] = {
+    [SCULL_STAT_READS] = "reads",
+    [SCULL_STAT_WRITES] = "writes",
+    [SCULL_STAT_READ_BYTES] = "read_bytes",
+    [SCULL_STAT_WRITE_BYTES] = "write_bytes",
+    [SCULL_STAT_SHORT_READS] = "short_reads",
+    [SCULL_STAT_SHORT_WRITES] = "short_writes",
+    [SCULL_STAT_EAGAIN] = "eagain",
+    [SCULL_STAT_ALLOCS] = "allocs",
+    [SCULL_STAT_LOCK_WAIT] = "lock_wait_ns",
+    [SCULL_STAT_COMPRESS] = "compress",
+    [SCULL_STAT_DECOMPRESS] = "decompress",
+    [SCULL_STAT_ZERO] = "zero_quanta",
+    [SCULL_STAT_DEDUP] = "dedup",
+    [SCULL_STAT_COW] = "cow",
+    [SCULL_STAT_RECLAIM] = "reclaimed_bytes",
+    [SCULL_STAT_WRITEBACK] = "writeback",
+    [SCULL_STAT_REMAP] = "remapped",
+    [SCULL_STAT_CACHE_HIT] = "cache_hits",
+    [SCULL_STAT_CACHE_MISS] = "cache_misses",
+    [SCULL_STAT_CACHE_EVICT] = "cache_evictions",
+    [SCULL_STAT_CACHE_EXPIRE] = "cache_expired",
+};
+
+static const char *const scull_hist_names[SCULL_HIST_NR] = {
+    [SCULL_HIST_READ] = "read_ns",
+    [SCULL_HIST_WRITE] = "write_ns",
+    [SCULL_HIST_SLEEP] = "sleep_ns",
+    [SCULL_HIST_DECOMPRESS] = "decompress_ns",
+};
+
+static int scull_stats_show(struct seq_file *s, void *v) {
+    struct scull_stats __percpu *stats = s->private;
+    struct scull_stats *sum;
+    struct scull_stats *pcpu;
+    int cpu, i, j;
+
+    sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+    if (!sum) return -ENOMEM;
+
+    // 把各个 CPU 的值加起来，读取时不加锁，结果只是近似的快照
+    for_each_possible_cpu(cpu) {
+        pcpu = per_cpu_ptr(stats, cpu);
+        for (i = 0; i < SCULL_STAT_NR; i++) sum->count[i] += pcpu->count[i];
+        for (i = 0; i < SCULL_HIST_NR; i++)
+            for (j = 0; j < SCULL_HIST_BUCKETS; j++)
+                sum->hist[i][j] += pcpu->hist[i][j];
+    }
+
+    for (i = 0; i < SCULL_STAT_NR; i++)
+        seq_printf(s, "%-16s %llu\n", scull_stat_names[i], sum->count[i]);
+    // 直方图只输出非空的桶，每行是桶的下界（纳秒）和计数
+    for (i = 0; i < SCULL_HIST_NR; i++) {
+        seq_printf(s, "\n%s:\n", scull_hist_names[i]);
+        for (j = 0; j < SCULL_HIST_BUCKETS; j++)
+            if (sum->hist[i][j])
+                seq_printf(s, "%16llu %llu\n", j ? 1ULL << j : 0ULL,
+                           sum->hist[i][j]);
+    }
+
+    kfree(sum);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(scull_stats);
+
+static ssize_t scull_stats_reset(struct file *filp, const char __user *buf,
+                                 size_t count, loff_t *f_pos) {
+    struct scull_stats __percpu *stats = file_inode(filp)->i_private;
+    int cpu;
+
+    // 和更新并发时可能漏掉正在进行的几次更新，对统计来说可以接受
+    for_each_possible_cpu(cpu)
+        memset(per_cpu_ptr(stats, cpu), 0, sizeof(struct scull_stats));
+    return count;
+}
+
+static const struct file_operations scull_stats_reset_fops = {
+    .owner = THIS_MODULE,
+    .open = simple_open,
+    .write = scull_stats_reset,
+    .llseek = noop_llseek,
+};
+
+// 为一个设备创建 debugfs 目录
+// debugfs 不可用时这些函数什么都不做，统计计数照常进行，不影响设备的使用
+void scull_stats_register(const char *name, struct scull_stats __percpu *stats) {
+    struct dentry *dir;
+
+    dir = debugfs_create_dir(name, scull_debugfs_root);
+    debugfs_create_file("stats", 0444, dir, (void __force *)stats,
+                        &scull_stats_fops);
+    debugfs_create_file("reset", 0200, dir, (void __force *)stats,
+                        &scull_stats_reset_fops);
+}
+
+void scull_stats_init(void) {
+    scull_debugfs_root = debugfs_create_dir("scull", NULL);
+    debugfs_create_file_unsafe("stats_enabled", 0644, scull_debugfs_root, NULL,
+                               &scull_stats_enabled_fops);
+}
+
+// 必须在释放各个设备的计数器之前调用
+void scull_stats_cleanup(void) {
+    debugfs_remove_recursive(scull_debugfs_root);
+    scull_debugfs_root = NULL;
+}
@@ -0,0 +1,67 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+int main() {
+    char path[] = "/tmp/scull_backing_XXXXXX";
+    char buf[64];
+    int fd, bfd, ret;
+
+    bfd = mkstemp(path);
+    SCULL_ASSERT(bfd >= 0);
+    unlink(path);
+    ret = write(bfd, "persistent", 10);
+    SCULL_ASSERT(ret == 10);
+
+    fd = open(DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+
+    // 绑定时从文件加载内容
+    ret = ioctl(fd, SCULL_IOCTBACKING, bfd);
+    SCULL_ASSERT(ret == 0);
+    ret = pread(fd, buf, sizeof(buf), 0);
+    SCULL_ASSERT(ret == 10 && memcmp(buf, "persistent", 10) == 0);
+
+    // 修改在刷新之后出现在文件中
+    ret = pwrite(fd, "P", 1, 0);
+    SCULL_ASSERT(ret == 1);
+    ret = pwrite(fd, "!", 1, 10);
+    SCULL_ASSERT(ret == 1);
+    ret = ioctl(fd, SCULL_IOCFLUSH);
+    SCULL_ASSERT(ret == 0);
+    ret = pread(bfd, buf, sizeof(buf), 0);
+    SCULL_ASSERT(ret == 11 && memcmp(buf, "Persistent!", 11) == 0);
+
+    // fsync 也会写回
+    ret = pwrite(fd, "p", 1, 0);
+    SCULL_ASSERT(ret == 1);
+    SCULL_ASSERT(fsync(fd) == 0);
+    ret = pread(bfd, buf, 1, 0);
+    SCULL_ASSERT(ret == 1 && buf[0] == 'p');
+
+    // 清空设备会截断文件
+    close(fd);
+    fd = open(DEVICE, O_WRONLY);
+    SCULL_ASSERT(fd >= 0);
+    SCULL_ASSERT(fsync(fd) == 0);
+    SCULL_ASSERT(lseek(bfd, 0, SEEK_END) == 0);
+
+    // 普通文件以外的后备文件被拒绝
+    ret = ioctl(fd, SCULL_IOCTBACKING, fd);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+
+    ret = ioctl(fd, SCULL_IOCTBACKING, -1);
+    SCULL_ASSERT(ret == 0);
+    close(fd);
+    close(bfd);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define VMIN 8
+#define VTIME_MS 200
+
+int fd;
+
+// 分两次写入，两次之间的间隔小于 VTIME
+void *writer_thread(void *arg) {
+    usleep(50 * 1000);
+    write(fd, "1234", 4);
+    usleep(50 * 1000);
+    write(fd, "5678", 4);
+    return NULL;
+}
+
+void signal_handler(int sig) {
+    printf("Batch Timed out.\n");
+    exit(1);
+}
+
+// 单调时钟的毫秒数
+static long now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int main() {
+    int ret, avail;
+    long start;
+    char buf[VMIN * 2];
+    struct scull_p_batch batch = {.vmin = VMIN, .vtime = VTIME_MS};
+    pthread_t thr;
+
+    signal(SIGALRM, signal_handler);
+    alarm(TIMEOUT_SECONDS);
+
+    fd = open(PIPE_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+
+    // 空管道中没有可读的数据
+    avail = -1;
+    ret = ioctl(fd, FIONREAD, &avail);
+    SCULL_ASSERT(ret == 0 && avail == 0);
+
+    ret = ioctl(fd, SCULL_P_IOCSBATCH, &batch);
+    SCULL_ASSERT(ret == 0);
+    memset(&batch, 0, sizeof(batch));
+    ret = ioctl(fd, SCULL_P_IOCGBATCH, &batch);
+    SCULL_ASSERT(ret == 0);
+    SCULL_ASSERT(batch.vmin == VMIN && batch.vtime == VTIME_MS);
+
+    // 两次写入的数据在一次读取中返回
+    pthread_create(&thr, NULL, writer_thread, NULL);
+    ret = read(fd, buf, sizeof(buf));
+    pthread_join(thr, NULL);
+    SCULL_ASSERT(ret == VMIN);
+    SCULL_ASSERT(!memcmp(buf, "12345678", VMIN));
+
+    // 数据不足 vmin 时，超时后返回已有的数据
+    ret = write(fd, "1234", 4);
+    SCULL_ASSERT(ret == 4);
+    ret = ioctl(fd, FIONREAD, &avail);
+    SCULL_ASSERT(ret == 0 && avail == 4);
+    start = now_ms();
+    ret = read(fd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 4);
+    SCULL_ASSERT(!memcmp(buf, "1234", 4));
+    // 读取一直等到 VTIME 超时才返回
+    SCULL_ASSERT(now_ms() - start >= VTIME_MS - 10);
+    SCULL_ASSERT(now_ms() - start < TIMEOUT_SECONDS * 1000);
+    ret = ioctl(fd, FIONREAD, &avail);
+    SCULL_ASSERT(ret == 0 && avail == 0);
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define MESSAGE "Hello, subscribers!"
+
+int main() {
+    int wfd, rfd1, rfd2, ret, size, i;
+    unsigned long long dropped;
+    char buf[SCULL_P_BUFFER];
+
+    wfd = open(PIPE_DEVICE, O_WRONLY | O_NONBLOCK);
+    rfd1 = open(PIPE_DEVICE, O_RDONLY | O_NONBLOCK);
+    rfd2 = open(PIPE_DEVICE, O_RDONLY | O_NONBLOCK);
+    if (wfd < 0 || rfd1 < 0 || rfd2 < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    // 缓冲区大小可能被其他测试修改过
+    size = ioctl(wfd, SCULL_P_IOCQSIZE);
+    SCULL_ASSERT(size > 0 && size <= SCULL_P_BUFFER);
+
+    // 越过慢读者必须和广播模式一起使用
+    ret = ioctl(wfd, SCULL_P_IOCTMODE, SCULL_P_LAP);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+
+    ret = ioctl(wfd, SCULL_P_IOCTMODE, SCULL_P_BROADCAST);
+    SCULL_ASSERT(ret == 0);
+    ret = ioctl(wfd, SCULL_P_IOCQMODE);
+    SCULL_ASSERT(ret == SCULL_P_BROADCAST);
+
+    // 一次写入，每个读者都能读到
+    ret = write(wfd, MESSAGE, strlen(MESSAGE));
+    SCULL_ASSERT(ret == (int)strlen(MESSAGE));
+    memset(buf, 0, sizeof(buf));
+    ret = read(rfd1, buf, sizeof(buf));
+    SCULL_ASSERT(ret == (int)strlen(MESSAGE) && !strcmp(buf, MESSAGE));
+    memset(buf, 0, sizeof(buf));
+    ret = read(rfd2, buf, sizeof(buf));
+    SCULL_ASSERT(ret == (int)strlen(MESSAGE) && !strcmp(buf, MESSAGE));
+
+    // 越过慢读者：第二个读者一直不读，写者也不会阻塞
+    ret = ioctl(wfd, SCULL_P_IOCTMODE, SCULL_P_BROADCAST | SCULL_P_LAP);
+    SCULL_ASSERT(ret == 0);
+    memset(buf, 'A', sizeof(buf));
+    for (i = 0; i < 8; i++) {
+        ret = write(wfd, buf, size / 2);
+        SCULL_ASSERT(ret > 0);
+        ret = read(rfd1, buf, sizeof(buf));
+        SCULL_ASSERT(ret > 0);
+    }
+    ret = ioctl(rfd1, SCULL_P_IOCGDROPPED, &dropped);
+    SCULL_ASSERT(ret == 0 && dropped == 0);
+    ret = ioctl(rfd2, SCULL_P_IOCGDROPPED, &dropped);
+    SCULL_ASSERT(ret == 0 && dropped > 0);
+
+    close(rfd2);
+    close(rfd1);
+    close(wfd);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define BUSY_POLL_US 200
+
+int fd;
+
+void *writer_thread(void *arg) {
+    usleep(50);
+    write(fd, "ping", 4);
+    return NULL;
+}
+
+void signal_handler(int sig) {
+    printf("Busy poll Timed out.\n");
+    exit(1);
+}
+
+int main() {
+    int ret, i;
+    char buf[16];
+    pthread_t thr;
+
+    signal(SIGALRM, signal_handler);
+    alarm(TIMEOUT_SECONDS);
+
+    fd = open(PIPE_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+
+    // 超过上限的预算
+    ret = ioctl(fd, SCULL_P_IOCTBUSYPOLL, 1 << 30);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+
+    ret = ioctl(fd, SCULL_P_IOCTBUSYPOLL, BUSY_POLL_US);
+    SCULL_ASSERT(ret == 0);
+    ret = ioctl(fd, SCULL_P_IOCQBUSYPOLL);
+    SCULL_ASSERT(ret == BUSY_POLL_US);
+
+    // 无论数据是在忙等期间还是睡眠之后到达，读者都要拿到完整的数据
+    for (i = 0; i < 10; i++) {
+        pthread_create(&thr, NULL, writer_thread, NULL);
+        ret = read(fd, buf, sizeof(buf));
+        pthread_join(thr, NULL);
+        SCULL_ASSERT(ret == 4);
+        SCULL_ASSERT(!memcmp(buf, "ping", 4));
+    }
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// 使用 scullfd，每次打开得到一个新的设备，不影响其他测试
+#define CACHE_DEVICE "/dev/scullfd"
+
+static int set_cache(int fd, unsigned int flags, unsigned int ttl_ms,
+                     unsigned long long budget) {
+    struct scull_cache c = {flags, ttl_ms, budget};
+
+    return ioctl(fd, SCULL_IOCSCACHE, &c);
+}
+
+int main() {
+    struct scull_cache c;
+    struct scull_kv kv;
+    int fd, quantum, ret;
+    char *buf, *kvbuf;
+
+    fd = open(CACHE_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    quantum = ioctl(fd, SCULL_IOCQQUANTUM);
+    SCULL_ASSERT(quantum > 0);
+    buf = malloc(quantum);
+    SCULL_ASSERT(buf != NULL);
+
+    ret = set_cache(fd, 0x80, 0, 0);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+    // 预算是 2 个量子
+    SCULL_ASSERT(set_cache(fd, SCULL_CACHE_ON, 0, 2ULL * quantum) == 0);
+    SCULL_ASSERT(ioctl(fd, SCULL_IOCGCACHE, &c) == 0);
+    SCULL_ASSERT(c.flags == SCULL_CACHE_ON && c.ttl_ms == 0 &&
+                 c.budget == 2ULL * quantum);
+
+    memset(buf, 'a', quantum);
+    SCULL_ASSERT(pwrite(fd, buf, quantum, 0) == quantum);
+    memset(buf, 'b', quantum);
+    SCULL_ASSERT(pwrite(fd, buf, quantum, quantum) == quantum);
+    // 读一次第 0 个量子，第 1 个量子变成最久没有访问的
+    SCULL_ASSERT(pread(fd, buf, quantum, 0) == quantum && buf[0] == 'a');
+    // 写第 2 个量子超出预算，淘汰第 1 个量子
+    memset(buf, 'c', quantum);
+    SCULL_ASSERT(pwrite(fd, buf, quantum, 2 * quantum) == quantum);
+    ret = pread(fd, buf, quantum, quantum);
+    SCULL_ASSERT(ret < 0 && errno == ENODATA);
+    SCULL_ASSERT(pread(fd, buf, quantum, 0) == quantum && buf[0] == 'a');
+    SCULL_ASSERT(pread(fd, buf, quantum, 2 * quantum) == quantum &&
+                 buf[0] == 'c');
+
+    // 全零的量子在缓存模式下也要保存
+    memset(buf, 0, quantum);
+    SCULL_ASSERT(pwrite(fd, buf, quantum, 0) == quantum);
+    SCULL_ASSERT(pread(fd, buf, quantum, 0) == quantum);
+
+    // 设备不为空时不能关闭缓存模式
+    ret = set_cache(fd, 0, 0, 0);
+    SCULL_ASSERT(ret < 0 && errno == EBUSY);
+
+    // 过期
+    SCULL_ASSERT(set_cache(fd, SCULL_CACHE_ON, 100, 0) == 0);
+    usleep(300 * 1000);
+    ret = pread(fd, buf, quantum, 0);
+    SCULL_ASSERT(ret < 0 && errno == ENODATA);
+    ret = pread(fd, buf, quantum, 2 * quantum);
+    SCULL_ASSERT(ret < 0 && errno == ENODATA);
+
+    close(fd);
+
+    // 键值存储的值不在 LRU 链表中，不占用缓存的预算：
+    // 值本身超过预算时，缓存的量子仍然保留
+    fd = open(CACHE_DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+    kvbuf = calloc(3, quantum);
+    SCULL_ASSERT(kvbuf != NULL);
+    kv.key = (unsigned long)"key";
+    kv.klen = 3;
+    kv.val = (unsigned long)kvbuf;
+    kv.vlen = 3 * quantum;
+    SCULL_ASSERT(ioctl(fd, SCULL_IOCKVPUT, &kv) == 0);
+    SCULL_ASSERT(set_cache(fd, SCULL_CACHE_ON, 0, 2ULL * quantum) == 0);
+    memset(buf, 'a', quantum);
+    SCULL_ASSERT(pwrite(fd, buf, quantum, 0) == quantum);
+    memset(buf, 'b', quantum);
+    SCULL_ASSERT(pwrite(fd, buf, quantum, quantum) == quantum);
+    SCULL_ASSERT(pread(fd, buf, quantum, 0) == quantum && buf[0] == 'a');
+    SCULL_ASSERT(pread(fd, buf, quantum, quantum) == quantum && buf[0] == 'b');
+
+    free(kvbuf);
+    free(buf);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// 从 /proc/scullmem 中取出 scull0 的量子大小和被压缩的量子数量
+static int get_zquanta(int *quantum, unsigned long *zquanta) {
+    FILE *f = fopen("/proc/scullmem", "r");
+    char line[256];
+    int ret = -1;
+
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "scull0 %*u %d %*d %*u %*u %*u %*u %*u %*d %lu",
+                   quantum, zquanta) == 2) {
+            ret = 0;
+            break;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+int main() {
+    int fd, ret, quantum, i;
+    unsigned long zquanta;
+    char buf[4096], out[4096];
+
+    // 以只写方式打开会清空设备
+    fd = open(DEVICE, O_WRONLY);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    close(fd);
+    fd = open(DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+    SCULL_ASSERT(get_zquanta(&quantum, &zquanta) == 0);
+    if (quantum > (int)sizeof(buf)) quantum = sizeof(buf);
+
+    // 写入一个容易压缩的量子
+    for (i = 0; i < quantum; i++) buf[i] = "scull"[i % 5];
+    ret = write(fd, buf, quantum);
+    SCULL_ASSERT(ret == quantum);
+
+    ret = ioctl(fd, SCULL_IOCTCOMPRESS, 100);
+    SCULL_ASSERT(ret == 0);
+    SCULL_ASSERT(ioctl(fd, SCULL_IOCQCOMPRESS) == 100);
+
+    // 量子超过 100 毫秒没有访问后被压缩
+    sleep(1);
+    SCULL_ASSERT(get_zquanta(&quantum, &zquanta) == 0);
+    SCULL_ASSERT(zquanta == 1);
+
+    // 读取时解压，内容不变
+    ret = pread(fd, out, quantum, 0);
+    SCULL_ASSERT(ret == quantum);
+    SCULL_ASSERT(memcmp(buf, out, quantum) == 0);
+    SCULL_ASSERT(get_zquanta(&quantum, &zquanta) == 0);
+    SCULL_ASSERT(zquanta == 0);
+
+    ret = ioctl(fd, SCULL_IOCTCOMPRESS, 0);
+    SCULL_ASSERT(ret == 0);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define DST_DEVICE "/dev/scull1"
+
+// 从 /proc/scullmem 中取出设备的量子大小和共享的量子数量
+static int get_mem(const char *dev, int *quantum, unsigned long *shared) {
+    FILE *f = fopen("/proc/scullmem", "r");
+    char line[256], name[16];
+    int ret = -1;
+
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line,
+                   "%15s %*u %d %*d %*u %*u %*u %*u %*u %*d %*u %*u %lu",
+                   name, quantum, shared) == 3 &&
+            strcmp(name, dev) == 0) {
+            ret = 0;
+            break;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+int main() {
+    int src, dst, ret, quantum, i;
+    unsigned long shared;
+    char buf[4096 * 3], out[sizeof(buf)];
+    struct scull_copy c;
+
+    // 以只写方式打开会清空设备
+    src = open(DEVICE, O_WRONLY);
+    if (src < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    close(src);
+    dst = open(DST_DEVICE, O_WRONLY);
+    SCULL_ASSERT(dst >= 0);
+    close(dst);
+    src = open(DEVICE, O_RDWR);
+    dst = open(DST_DEVICE, O_RDWR);
+    SCULL_ASSERT(src >= 0 && dst >= 0);
+    SCULL_ASSERT(get_mem("scull0", &quantum, &shared) == 0);
+    if (3 * quantum > (int)sizeof(buf)) return 0;
+
+    for (i = 0; i < 3 * quantum; i++) buf[i] = 'a' + i % 26;
+    // 每次写入不超过一个量子
+    for (i = 0; i < 3; i++) {
+        ret = write(src, buf + i * quantum, quantum);
+        SCULL_ASSERT(ret == quantum);
+    }
+
+    // 对齐的拷贝共享量子
+    memset(&c, 0, sizeof(c));
+    c.src_fd = src;
+    c.len = 3 * quantum;
+    c.flags = SCULL_COPY_REMAP;
+    ret = ioctl(dst, SCULL_IOCCOPY, &c);
+    SCULL_ASSERT(ret == 3 * quantum);
+    SCULL_ASSERT(get_mem("scull1", &quantum, &shared) == 0 && shared == 3);
+    for (i = 0; i < 3; i++) {
+        ret = pread(dst, out + i * quantum, quantum, i * quantum);
+        SCULL_ASSERT(ret == quantum);
+    }
+    SCULL_ASSERT(memcmp(out, buf, 3 * quantum) == 0);
+
+    // 写入源设备不影响目标
+    ret = pwrite(src, "X", 1, 0);
+    SCULL_ASSERT(ret == 1);
+    ret = pread(dst, out, 1, 0);
+    SCULL_ASSERT(ret == 1 && out[0] == buf[0]);
+
+    // 不对齐时 REMAP 失败，普通拷贝经过内核缓冲区完成
+    c.src_off = 1;
+    c.dst_off = 3 * quantum;
+    c.len = 10;
+    ret = ioctl(dst, SCULL_IOCCOPY, &c);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+    c.flags = 0;
+    ret = ioctl(dst, SCULL_IOCCOPY, &c);
+    SCULL_ASSERT(ret == 10);
+    ret = pread(dst, out, 10, 3 * quantum);
+    SCULL_ASSERT(ret == 10 && memcmp(out, buf + 1, 10) == 0);
+
+    // 同一个设备内重叠的范围被拒绝
+    c.flags = 0;
+    c.src_fd = dst;
+    c.src_off = 0;
+    c.dst_off = 5;
+    ret = ioctl(dst, SCULL_IOCCOPY, &c);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+
+    // 目标已经超过内存上限：替换已有的量子不增加内存，可以完成；
+    // 共享到空洞上需要新的量子，失败时目标原有的数据不变
+    // 没有 CAP_SYS_RESOURCE 时跳过
+    ret = ioctl(dst, SCULL_IOCTLIMIT, quantum);
+    if (ret < 0 && errno == EPERM) goto out;
+    SCULL_ASSERT(ret == 0);
+    c.flags = SCULL_COPY_REMAP;
+    c.src_fd = src;
+    c.src_off = quantum;
+    c.dst_off = 0;
+    c.len = quantum;
+    ret = ioctl(dst, SCULL_IOCCOPY, &c);
+    SCULL_ASSERT(ret == quantum);
+    ret = pread(dst, out, quantum, 0);
+    SCULL_ASSERT(ret == quantum && memcmp(out, buf + quantum, quantum) == 0);
+    c.dst_off = 5 * quantum;
+    ret = ioctl(dst, SCULL_IOCCOPY, &c);
+    SCULL_ASSERT(ret < 0 && errno == ENOSPC);
+    ret = pread(dst, out, 10, 3 * quantum);
+    SCULL_ASSERT(ret == 10 && memcmp(out, buf + 1, 10) == 0);
+    ret = ioctl(dst, SCULL_IOCTLIMIT, 0);
+    SCULL_ASSERT(ret == 0);
+
+out:
+    close(src);
+    close(dst);
+    return 0;
+}
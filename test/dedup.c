@@ -0,0 +1,83 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// 从 /proc/scullmem 中取出 scull0 的量子大小、量子数量、空洞数量和共享的量子数量
+static int get_mem(int *quantum, unsigned long *quanta, unsigned long *holes,
+                   unsigned long *shared) {
+    FILE *f = fopen("/proc/scullmem", "r");
+    char line[256];
+    int ret = -1;
+
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line,
+                   "scull0 %*u %d %*d %*u %lu %lu %*u %*u %*d %*u %*u %lu",
+                   quantum, quanta, holes, shared) == 4) {
+            ret = 0;
+            break;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+int main() {
+    int fd, ret, quantum, i;
+    unsigned long quanta, holes, shared;
+    char buf[4096], out[4096], zero[4096] = {0};
+
+    // 以只写方式打开会清空设备
+    fd = open(DEVICE, O_WRONLY);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    close(fd);
+    fd = open(DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+    SCULL_ASSERT(get_mem(&quantum, &quanta, &holes, &shared) == 0);
+    // 测试需要整量子写入
+    if (quantum > (int)sizeof(buf)) return 0;
+
+    ret = ioctl(fd, SCULL_IOCTDEDUP, 1);
+    SCULL_ASSERT(ret == 0);
+    SCULL_ASSERT(ioctl(fd, SCULL_IOCQDEDUP) == 1);
+
+    // 三个内容相同的量子共享一份内存，全零的量子不分配
+    memset(buf, 'x', quantum);
+    for (i = 0; i < 3; i++) {
+        ret = write(fd, buf, quantum);
+        SCULL_ASSERT(ret == quantum);
+    }
+    ret = write(fd, zero, quantum);
+    SCULL_ASSERT(ret == quantum);
+    SCULL_ASSERT(get_mem(&quantum, &quanta, &holes, &shared) == 0);
+    SCULL_ASSERT(quanta == 3 && shared == 3 && holes == 1);
+
+    // 写入共享的量子时复制一份，其他量子不受影响
+    ret = pwrite(fd, "y", 1, quantum);
+    SCULL_ASSERT(ret == 1);
+    SCULL_ASSERT(get_mem(&quantum, &quanta, &holes, &shared) == 0);
+    SCULL_ASSERT(quanta == 3 && shared == 2);
+    ret = pread(fd, out, quantum, 0);
+    SCULL_ASSERT(ret == quantum && memcmp(out, buf, quantum) == 0);
+    ret = pread(fd, out, quantum, quantum);
+    SCULL_ASSERT(ret == quantum && out[0] == 'y' &&
+                 memcmp(out + 1, buf + 1, quantum - 1) == 0);
+
+    // 空洞读出来是零
+    memset(out, 1, quantum);
+    ret = pread(fd, out, quantum, 3 * quantum);
+    SCULL_ASSERT(ret == quantum && memcmp(out, zero, quantum) == 0);
+
+    ret = ioctl(fd, SCULL_IOCTDEDUP, 0);
+    SCULL_ASSERT(ret == 0);
+    close(fd);
+    return 0;
+}
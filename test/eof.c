@@ -0,0 +1,68 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+int rfd;
+ssize_t blocked_ret = -1;
+
+void *read_thread(void *arg) {
+    char buf[16];
+
+    blocked_ret = read(rfd, buf, sizeof(buf));
+    return NULL;
+}
+
+int main() {
+    int wfd, ret;
+    char buf[16];
+    struct pollfd pfd;
+    pthread_t tid;
+
+    // 读者先于写者打开，此时还不是文件尾
+    rfd = open(PIPE_DEVICE, O_RDONLY | O_NONBLOCK);
+    if (rfd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    pfd.fd = rfd;
+    pfd.events = POLLIN;
+    ret = poll(&pfd, 1, 0);
+    SCULL_ASSERT(ret == 0);
+
+    // 写者关闭后，剩余的数据仍然可以读取，读完之后读取返回 0
+    wfd = open(PIPE_DEVICE, O_WRONLY);
+    SCULL_ASSERT(wfd >= 0);
+    ret = write(wfd, "abc", 3);
+    SCULL_ASSERT(ret == 3);
+    close(wfd);
+    ret = poll(&pfd, 1, 0);
+    SCULL_ASSERT(ret == 1 && (pfd.revents & POLLIN) && (pfd.revents & POLLHUP));
+    ret = read(rfd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 3);
+    ret = read(rfd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 0);
+    pfd.events = POLLIN | POLLRDHUP;
+    ret = poll(&pfd, 1, 0);
+    SCULL_ASSERT(ret == 1 && !(pfd.revents & POLLIN) &&
+                 (pfd.revents & POLLHUP) && (pfd.revents & POLLRDHUP));
+
+    // 新的写者打开后不再是文件尾；它关闭时唤醒阻塞的读者
+    wfd = open(PIPE_DEVICE, O_WRONLY);
+    SCULL_ASSERT(wfd >= 0);
+    fcntl(rfd, F_SETFL, 0);
+    pthread_create(&tid, NULL, read_thread, NULL);
+    sleep(1);
+    SCULL_ASSERT(blocked_ret == -1);
+    close(wfd);
+    pthread_join(tid, NULL);
+    SCULL_ASSERT(blocked_ret == 0);
+
+    close(rfd);
+    return 0;
+}
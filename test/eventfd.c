@@ -0,0 +1,65 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+int main() {
+    int fd, efd, ret;
+    uint64_t value;
+    char buf[16];
+    struct scull_p_eventfd evfd;
+    struct pollfd pfd;
+
+    fd = open(PIPE_DEVICE, O_RDWR | O_NONBLOCK);
+    efd = eventfd(0, EFD_NONBLOCK);
+    if (fd < 0 || efd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+
+    evfd.rfd = efd;
+    evfd.wfd = -1;
+    ret = ioctl(fd, SCULL_P_IOCSEVENTFD, &evfd);
+    SCULL_ASSERT(ret == 0);
+
+    // 缓冲区从空变为有数据时通知一次，之后的写入不再通知
+    ret = write(fd, "data", 4);
+    SCULL_ASSERT(ret == 4);
+    ret = write(fd, "more", 4);
+    SCULL_ASSERT(ret == 4);
+    pfd.fd = efd;
+    pfd.events = POLLIN;
+    ret = poll(&pfd, 1, TIMEOUT_SECONDS * 1000);
+    SCULL_ASSERT(ret == 1 && (pfd.revents & POLLIN));
+    ret = read(efd, &value, sizeof(value));
+    SCULL_ASSERT(ret == sizeof(value) && value == 1);
+
+    // 读空之后再次写入，重新通知
+    ret = read(fd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 8);
+    ret = write(fd, "again", 5);
+    SCULL_ASSERT(ret == 5);
+    ret = read(efd, &value, sizeof(value));
+    SCULL_ASSERT(ret == sizeof(value) && value == 1);
+    ret = read(fd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 5);
+
+    // 取消注册
+    evfd.rfd = -1;
+    ret = ioctl(fd, SCULL_P_IOCSEVENTFD, &evfd);
+    SCULL_ASSERT(ret == 0);
+    ret = write(fd, "none", 4);
+    SCULL_ASSERT(ret == 4);
+    ret = read(efd, &value, sizeof(value));
+    SCULL_ASSERT(ret < 0 && errno == EAGAIN);
+
+    close(efd);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define HANDOFF_PARAM "/sys/module/scull/parameters/scull_p_handoff_min"
+#define PAGE 4096
+
+int fd;
+char *rbuf;       // 读者的缓冲区，按页对齐
+int rlen;         // 读者请求的长度
+ssize_t rret;     // 读者的返回值
+int rerrno;       // 读者的错误码
+char data[2 * PAGE];
+
+void *reader_thread(void *arg) {
+    rret = read(fd, rbuf, rlen);
+    rerrno = errno;
+    return NULL;
+}
+
+// 在后台开始一次阻塞读取，等它进入交接等待
+static pthread_t start_reader(int len) {
+    pthread_t thr;
+
+    rlen = len;
+    memset(rbuf, 0, 2 * PAGE);
+    pthread_create(&thr, NULL, reader_thread, NULL);
+    usleep(100 * 1000);
+    return thr;
+}
+
+static void set_handoff_min(const char *val) {
+    int pfd = open(HANDOFF_PARAM, O_WRONLY);
+
+    SCULL_ASSERT(pfd >= 0);
+    SCULL_ASSERT(write(pfd, val, strlen(val)) == (ssize_t)strlen(val));
+    close(pfd);
+}
+
+void signal_handler(int sig) {
+    printf("Handoff Timed out.\n");
+    set_handoff_min("0");
+    exit(1);
+}
+
+void interrupt_handler(int sig) {}
+
+int main() {
+    struct sigaction sa = {.sa_handler = interrupt_handler};
+    char saved[32] = "0", buf[100];
+    pthread_t thr;
+    int pfd, ret, i;
+
+    // 保存模块参数，测试结束后恢复
+    pfd = open(HANDOFF_PARAM, O_RDONLY);
+    if (pfd < 0) {
+        perror("Failed to open " HANDOFF_PARAM);
+        return errno;
+    }
+    ret = read(pfd, saved, sizeof(saved) - 1);
+    SCULL_ASSERT(ret > 0);
+    saved[ret] = '\0';
+    close(pfd);
+
+    signal(SIGALRM, signal_handler);
+    alarm(TIMEOUT_SECONDS);
+    // 不带 SA_RESTART，被信号打断的读取返回 EINTR
+    sigaction(SIGUSR1, &sa, NULL);
+
+    fd = open(PIPE_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    rbuf = aligned_alloc(PAGE, 2 * PAGE);
+    SCULL_ASSERT(rbuf);
+    for (i = 0; i < sizeof(data); i++) data[i] = 'a' + i % 26;
+    set_handoff_min("4096");
+
+    // 写入的数据少于读者的请求：整块交给读者，双方都返回写入的长度
+    thr = start_reader(2 * PAGE);
+    ret = write(fd, data, 3000);
+    pthread_join(thr, NULL);
+    SCULL_ASSERT(ret == 3000);
+    SCULL_ASSERT(rret == 3000);
+    SCULL_ASSERT(!memcmp(rbuf, data, 3000));
+
+    // 写入的数据多于读者的请求：只交接读者缓冲区的长度，写入返回不足的长度
+    thr = start_reader(PAGE);
+    ret = write(fd, data, sizeof(data));
+    pthread_join(thr, NULL);
+    SCULL_ASSERT(ret == PAGE);
+    SCULL_ASSERT(rret == PAGE);
+    SCULL_ASSERT(!memcmp(rbuf, data, PAGE));
+    // 剩余的数据重新写入，没有读者在等待，进入环形缓冲区
+    ret = write(fd, data + PAGE, 100);
+    SCULL_ASSERT(ret == 100);
+    ret = read(fd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 100);
+    SCULL_ASSERT(!memcmp(buf, data + PAGE, 100));
+
+    // 等待交接的读者被信号打断：返回 EINTR，之后的写入不会交给已经离开的读者
+    thr = start_reader(PAGE);
+    pthread_kill(thr, SIGUSR1);
+    pthread_join(thr, NULL);
+    SCULL_ASSERT(rret < 0 && rerrno == EINTR);
+    ret = write(fd, data, 100);
+    SCULL_ASSERT(ret == 100);
+    ret = read(fd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 100);
+    SCULL_ASSERT(!memcmp(buf, data, 100));
+
+    set_handoff_min(saved);
+    free(rbuf);
+    close(fd);
+    return 0;
+}
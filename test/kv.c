@@ -0,0 +1,96 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+static int kv(int fd, unsigned long cmd, const char *key, void *val,
+              unsigned int *vlen) {
+    struct scull_kv a;
+    int ret;
+
+    a.key = (unsigned long)key;
+    a.klen = strlen(key);
+    a.val = (unsigned long)val;
+    a.vlen = vlen ? *vlen : 0;
+    ret = ioctl(fd, cmd, &a);
+    if (vlen) *vlen = a.vlen;
+    return ret;
+}
+
+int main() {
+    static char big[10000], out[10000];
+    unsigned int vlen;
+    int fd, ret, i;
+    char small[4];
+
+    // 以只写方式打开会清空设备的字节流，键值存储不受影响
+    fd = open(DEVICE, O_WRONLY);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    close(fd);
+    fd = open(DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+
+    vlen = 5;
+    SCULL_ASSERT(kv(fd, SCULL_IOCKVPUT, "hello", "world", &vlen) == 0);
+    // 跨越多个量子的值
+    for (i = 0; i < (int)sizeof(big); i++) big[i] = i % 251;
+    vlen = sizeof(big);
+    SCULL_ASSERT(kv(fd, SCULL_IOCKVPUT, "big", big, &vlen) == 0);
+
+    vlen = sizeof(out);
+    ret = kv(fd, SCULL_IOCKVGET, "hello", out, &vlen);
+    SCULL_ASSERT(ret == 5 && vlen == 5 && memcmp(out, "world", 5) == 0);
+    vlen = sizeof(out);
+    ret = kv(fd, SCULL_IOCKVGET, "big", out, &vlen);
+    SCULL_ASSERT(ret == sizeof(big) && memcmp(out, big, sizeof(big)) == 0);
+
+    // 缓冲区不够大时返回需要的大小
+    vlen = sizeof(small);
+    ret = kv(fd, SCULL_IOCKVGET, "hello", small, &vlen);
+    SCULL_ASSERT(ret < 0 && errno == ERANGE && vlen == 5);
+
+    // 替换和删除
+    vlen = 3;
+    SCULL_ASSERT(kv(fd, SCULL_IOCKVPUT, "hello", "you", &vlen) == 0);
+    vlen = sizeof(out);
+    ret = kv(fd, SCULL_IOCKVGET, "hello", out, &vlen);
+    SCULL_ASSERT(ret == 3 && memcmp(out, "you", 3) == 0);
+    SCULL_ASSERT(kv(fd, SCULL_IOCKVDEL, "hello", NULL, NULL) == 0);
+    ret = kv(fd, SCULL_IOCKVDEL, "hello", NULL, NULL);
+    SCULL_ASSERT(ret < 0 && errno == ENOENT);
+    vlen = sizeof(out);
+    ret = kv(fd, SCULL_IOCKVGET, "hello", out, &vlen);
+    SCULL_ASSERT(ret < 0 && errno == ENOENT);
+
+    // 键值存储和字节流互不影响
+    ret = pread(fd, out, 1, 0);
+    SCULL_ASSERT(ret == 0);
+    ret = pwrite(fd, "data", 4, 0);
+    SCULL_ASSERT(ret == 4);
+
+    // 以只写方式打开截断字节流，键值存储保留
+    close(fd);
+    fd = open(DEVICE, O_WRONLY);
+    SCULL_ASSERT(fd >= 0);
+    close(fd);
+    fd = open(DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+    ret = pread(fd, out, 1, 0);
+    SCULL_ASSERT(ret == 0);
+    vlen = sizeof(out);
+    ret = kv(fd, SCULL_IOCKVGET, "big", out, &vlen);
+    SCULL_ASSERT(ret == sizeof(big) && memcmp(out, big, sizeof(big)) == 0);
+    SCULL_ASSERT(kv(fd, SCULL_IOCKVDEL, "big", NULL, NULL) == 0);
+
+    ret = kv(fd, SCULL_IOCKVPUT, "", "x", NULL);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+    close(fd);
+    return 0;
+}
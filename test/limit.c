@@ -0,0 +1,79 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// 从 /proc/scullmem 中取出 scull0 的量子大小
+static int get_quantum(void) {
+    FILE *f = fopen("/proc/scullmem", "r");
+    char line[256];
+    int quantum = -1;
+
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "scull0 %*u %d", &quantum) == 1) break;
+    fclose(f);
+    return quantum;
+}
+
+int main() {
+    int fd, ret, quantum;
+    char buf[4096];
+
+    // 以只写方式打开会清空设备
+    fd = open(DEVICE, O_WRONLY);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    close(fd);
+    fd = open(DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+    quantum = get_quantum();
+    SCULL_ASSERT(quantum > 0);
+    if (quantum > (int)sizeof(buf)) return 0;
+
+    // 没有 CAP_SYS_RESOURCE 时跳过
+    ret = ioctl(fd, SCULL_IOCTLIMIT, 2 * quantum);
+    if (ret < 0 && errno == EPERM) return 0;
+    SCULL_ASSERT(ret == 0);
+    SCULL_ASSERT(ioctl(fd, SCULL_IOCQLIMIT) == 2 * quantum);
+
+    // 两个量子之内可以写入，第三个量子返回 ENOSPC
+    memset(buf, 'x', quantum);
+    ret = write(fd, buf, quantum);
+    SCULL_ASSERT(ret == quantum);
+    ret = write(fd, buf, quantum);
+    SCULL_ASSERT(ret == quantum);
+    ret = write(fd, buf, 1);
+    SCULL_ASSERT(ret < 0 && errno == ENOSPC);
+
+    // 空洞中写入零不需要分配量子，达到上限时也能完成
+    memset(buf, 0, quantum);
+    ret = pwrite(fd, buf, quantum, 3 * quantum);
+    SCULL_ASSERT(ret == quantum);
+    buf[0] = 'z';
+    ret = pread(fd, buf, quantum, 3 * quantum);
+    SCULL_ASSERT(ret == quantum && !buf[0] && !memcmp(buf, buf + 1, quantum - 1));
+    memset(buf, 'x', quantum);
+
+    // 已经分配的量子可以继续覆盖写
+    ret = pwrite(fd, "y", 1, quantum);
+    SCULL_ASSERT(ret == 1);
+
+    // 清空设备之后额度恢复
+    close(fd);
+    fd = open(DEVICE, O_WRONLY);
+    SCULL_ASSERT(fd >= 0);
+    ret = write(fd, buf, quantum);
+    SCULL_ASSERT(ret == quantum);
+
+    ret = ioctl(fd, SCULL_IOCTLIMIT, 0);
+    SCULL_ASSERT(ret == 0);
+    close(fd);
+    return 0;
+}
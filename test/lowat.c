@@ -0,0 +1,136 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define RCVLOWAT 8
+#define TOTAL (SCULL_P_BUFFER * 2)
+
+int bfd;  // 以阻塞方式打开的管道
+
+// 不阻塞地检查一次管道状态
+static short poll_now(int fd) {
+    struct pollfd pfd = {.fd = fd, .events = POLLIN | POLLOUT};
+    int ret = poll(&pfd, 1, 0);
+    SCULL_ASSERT(ret >= 0);
+    return pfd.revents;
+}
+
+void signal_handler(int sig) {
+    printf("Low watermark deadlock.\n");
+    exit(1);
+}
+
+// 分两次写入，每次都不足读者等待的长度
+void *short_writer(void *arg) {
+    usleep(50 * 1000);
+    write(bfd, "1234", 4);
+    usleep(50 * 1000);
+    write(bfd, "5678", 4);
+    return NULL;
+}
+
+// 以大块写入 TOTAL 字节，数据为 0, 1, 2, ...
+void *bulk_writer(void *arg) {
+    static char data[TOTAL];
+    int done = 0, ret, i;
+
+    for (i = 0; i < TOTAL; i++) data[i] = i;
+    while (done < TOTAL) {
+        ret = write(bfd, data + done, TOTAL - done);
+        SCULL_ASSERT(ret > 0);
+        done += ret;
+    }
+    return NULL;
+}
+
+int main() {
+    int fd, ret, done, i;
+    char buf[RCVLOWAT * 2];
+    static char big[SCULL_P_BUFFER];
+    pthread_t thr;
+
+    fd = open(PIPE_DEVICE, O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+
+    // 非法的水位
+    ret = ioctl(fd, SCULL_P_IOCTRCVLOWAT, 0);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+
+    // 设置读低水位
+    ret = ioctl(fd, SCULL_P_IOCTRCVLOWAT, RCVLOWAT);
+    SCULL_ASSERT(ret == 0);
+    ret = ioctl(fd, SCULL_P_IOCQRCVLOWAT);
+    SCULL_ASSERT(ret == RCVLOWAT);
+
+    // 数据量低于水位时不报告可读
+    ret = write(fd, "1234", 4);
+    SCULL_ASSERT(ret == 4);
+    SCULL_ASSERT(!(poll_now(fd) & POLLIN));
+
+    // 达到水位后报告可读
+    ret = write(fd, "5678", 4);
+    SCULL_ASSERT(ret == 4);
+    SCULL_ASSERT(poll_now(fd) & POLLIN);
+
+    ret = read(fd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == RCVLOWAT);
+    SCULL_ASSERT(!memcmp(buf, "12345678", RCVLOWAT));
+
+    // 写低水位超过缓冲区容量时按缓冲区容量处理：空缓冲区仍然可写
+    ret = ioctl(fd, SCULL_P_IOCTSNDLOWAT, 1 << 30);
+    SCULL_ASSERT(ret == 0);
+    SCULL_ASSERT(poll_now(fd) & POLLOUT);
+
+    // 两个水位都设成缓冲区大小，阻塞的读写仍然可以进行
+    signal(SIGALRM, signal_handler);
+    alarm(TIMEOUT_SECONDS);
+    bfd = open(PIPE_DEVICE, O_RDWR);
+    SCULL_ASSERT(bfd >= 0);
+    ret = ioctl(fd, SCULL_P_IOCTRCVLOWAT, SCULL_P_BUFFER);
+    SCULL_ASSERT(ret == 0);
+    ret = ioctl(fd, SCULL_P_IOCTSNDLOWAT, SCULL_P_BUFFER);
+    SCULL_ASSERT(ret == 0);
+
+    // 短于水位的读写只等待请求的长度
+    ret = write(bfd, "1234", 4);
+    SCULL_ASSERT(ret == 4);
+    ret = read(bfd, buf, 4);
+    SCULL_ASSERT(ret == 4 && !memcmp(buf, "1234", 4));
+
+    // 读者等待的长度小于水位，写者分两次凑够后被唤醒
+    pthread_create(&thr, NULL, short_writer, NULL);
+    ret = read(bfd, buf, RCVLOWAT);
+    pthread_join(thr, NULL);
+    SCULL_ASSERT(ret == RCVLOWAT && !memcmp(buf, "12345678", RCVLOWAT));
+
+    // 大块的读写：读者等数据、写者等空间，不能互相等待。
+    // 读取的长度不超过剩余的数据量，否则最后一次读取会一直等待读低水位
+    pthread_create(&thr, NULL, bulk_writer, NULL);
+    for (done = 0; done < TOTAL; done += ret) {
+        ret = read(bfd, big,
+                   TOTAL - done < sizeof(big) ? TOTAL - done : sizeof(big));
+        SCULL_ASSERT(ret > 0);
+        for (i = 0; i < ret; i++) SCULL_ASSERT(big[i] == (char)(done + i));
+    }
+    pthread_join(thr, NULL);
+    alarm(0);
+
+    ret = ioctl(fd, SCULL_P_IOCTRCVLOWAT, 1);
+    SCULL_ASSERT(ret == 0);
+    ret = ioctl(fd, SCULL_P_IOCTSNDLOWAT, 1);
+    SCULL_ASSERT(ret == 0);
+
+    close(bfd);
+    close(fd);
+    return 0;
+}
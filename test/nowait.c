@@ -0,0 +1,55 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define BUFFER_SIZE 64
+
+int main() {
+    int fd, ret;
+    char write_buf[BUFFER_SIZE] = "Hello, nowait!";
+    char read_buf[BUFFER_SIZE] = {0};
+    struct iovec iov;
+
+    // scull 设备：没有锁竞争时，RWF_NOWAIT 的读写应该直接完成
+    fd = open(DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    iov.iov_base = write_buf;
+    iov.iov_len = strlen(write_buf);
+    ret = pwritev2(fd, &iov, 1, 0, RWF_NOWAIT);
+    SCULL_ASSERT(ret == (int)strlen(write_buf));
+    iov.iov_base = read_buf;
+    iov.iov_len = strlen(write_buf);
+    ret = preadv2(fd, &iov, 1, 0, RWF_NOWAIT);
+    SCULL_ASSERT(ret == (int)strlen(write_buf));
+    SCULL_ASSERT(!strcmp(write_buf, read_buf));
+    close(fd);
+
+    // scull pipe：缓冲区为空时，即使是阻塞打开，RWF_NOWAIT 的读也不能睡眠
+    fd = open(PIPE_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    memset(read_buf, 0, sizeof(read_buf));
+    iov.iov_base = read_buf;
+    iov.iov_len = sizeof(read_buf);
+    ret = preadv2(fd, &iov, 1, -1, RWF_NOWAIT);
+    SCULL_ASSERT(ret < 0 && errno == EAGAIN);
+
+    // 写入数据后可以立即读到
+    ret = write(fd, write_buf, strlen(write_buf));
+    SCULL_ASSERT(ret == (int)strlen(write_buf));
+    ret = preadv2(fd, &iov, 1, -1, RWF_NOWAIT);
+    SCULL_ASSERT(ret == (int)strlen(write_buf));
+    SCULL_ASSERT(!strcmp(write_buf, read_buf));
+    close(fd);
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define RECORD_SIZE 10
+
+int main() {
+    int fd, ret, size, i, total = 0;
+    unsigned long long dropped;
+    char record[RECORD_SIZE + 1], buf[SCULL_P_BUFFER];
+
+    fd = open(PIPE_DEVICE, O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    size = ioctl(fd, SCULL_P_IOCQSIZE);
+    SCULL_ASSERT(size > RECORD_SIZE && size <= SCULL_P_BUFFER);
+
+    // 记录模式必须和覆盖模式一起使用
+    ret = ioctl(fd, SCULL_P_IOCTMODE, SCULL_P_RECORDS);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+    ret = ioctl(fd, SCULL_P_IOCTMODE, SCULL_P_OVERWRITE | SCULL_P_RECORDS);
+    SCULL_ASSERT(ret == 0);
+
+    // 放不进缓冲区的记录
+    ret = write(fd, buf, size);
+    SCULL_ASSERT(ret < 0 && errno == EMSGSIZE);
+
+    // 写入超过缓冲区容量的记录，写者从不阻塞
+    for (i = 0; i < size; i++) {
+        snprintf(record, sizeof(record), "rec%06d", i % 1000000);
+        ret = write(fd, record, RECORD_SIZE);
+        SCULL_ASSERT(ret == RECORD_SIZE);
+    }
+
+    // 被丢弃的都是完整的记录，剩下的数据从记录的起点开始
+    ret = ioctl(fd, SCULL_P_IOCGDROPPED, &dropped);
+    SCULL_ASSERT(ret == 0 && dropped > 0 && dropped % RECORD_SIZE == 0);
+    while ((ret = read(fd, buf + total, sizeof(buf) - total)) > 0) total += ret;
+    SCULL_ASSERT(total > 0 && total % RECORD_SIZE == 0);
+    SCULL_ASSERT(!strncmp(buf, "rec", 3));
+    SCULL_ASSERT(dropped + total == (unsigned long long)size * RECORD_SIZE);
+    // 最后一条记录是最新写入的
+    snprintf(record, sizeof(record), "rec%06d", (size - 1) % 1000000);
+    SCULL_ASSERT(!memcmp(buf + total - RECORD_SIZE, record, RECORD_SIZE));
+
+    ret = ioctl(fd, SCULL_P_IOCTMODE, 0);
+    SCULL_ASSERT(ret == 0);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define PRIV_DEVICE "/dev/scullpriv"
+#define FD_DEVICE "/dev/scullfd"
+
+int main() {
+    int fd, fd2, ret, status;
+    char buf[16];
+    pid_t pid;
+
+    fd = open(PRIV_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    ret = write(fd, "parent", 6);
+    SCULL_ASSERT(ret == 6);
+
+    // 同一个进程再次打开看到同一个设备
+    fd2 = open(PRIV_DEVICE, O_RDONLY);
+    SCULL_ASSERT(fd2 >= 0);
+    ret = read(fd2, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 6 && memcmp(buf, "parent", 6) == 0);
+    close(fd2);
+
+    // 另一个进程打开得到自己的设备
+    pid = fork();
+    SCULL_ASSERT(pid >= 0);
+    if (pid == 0) {
+        fd2 = open(PRIV_DEVICE, O_RDWR);
+        if (fd2 < 0) _exit(1);
+        if (read(fd2, buf, sizeof(buf)) != 0) _exit(2);
+        if (write(fd2, "child", 5) != 5) _exit(3);
+        close(fd2);
+        _exit(0);
+    }
+    SCULL_ASSERT(waitpid(pid, &status, 0) == pid);
+    SCULL_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    ret = pread(fd, buf, sizeof(buf), 0);
+    SCULL_ASSERT(ret == 6 && memcmp(buf, "parent", 6) == 0);
+    close(fd);
+
+    // 所有文件关闭后设备被释放
+    fd = open(PRIV_DEVICE, O_RDONLY);
+    SCULL_ASSERT(fd >= 0);
+    ret = read(fd, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 0);
+    close(fd);
+
+    // scullfd 每次打开都是新设备
+    fd = open(FD_DEVICE, O_RDWR);
+    fd2 = open(FD_DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0 && fd2 >= 0);
+    ret = write(fd, "one", 3);
+    SCULL_ASSERT(ret == 3);
+    ret = read(fd2, buf, sizeof(buf));
+    SCULL_ASSERT(ret == 0);
+    close(fd);
+    close(fd2);
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// 从 /proc/scullmem 中取出 scull0 的一行
+static int get_mem(unsigned long *size, int *quantum, unsigned long *quanta,
+                   unsigned long *holes) {
+    FILE *f = fopen("/proc/scullmem", "r");
+    char line[256];
+    int ret = -1;
+
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "scull0 %lu %d %*d %*u %lu %lu", size, quantum,
+                   quanta, holes) == 4) {
+            ret = 0;
+            break;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+int main() {
+    int fd, ret, quantum;
+    unsigned long size, quanta, holes;
+
+    // 以只写方式打开会清空设备
+    fd = open(DEVICE, O_WRONLY);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    SCULL_ASSERT(get_mem(&size, &quantum, &quanta, &holes) == 0);
+    SCULL_ASSERT(size == 0 && quanta == 0 && holes == 0);
+
+    // 跳过第一个量子写入第二个量子，第一个量子是空洞
+    ret = pwrite(fd, "data", 4, quantum);
+    SCULL_ASSERT(ret == 4);
+    SCULL_ASSERT(get_mem(&size, &quantum, &quanta, &holes) == 0);
+    SCULL_ASSERT(size == (unsigned long)quantum + 4);
+    SCULL_ASSERT(quanta == 1 && holes == 1);
+
+    close(fd);
+    return 0;
+}
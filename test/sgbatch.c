@@ -0,0 +1,77 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define SIZE 20000
+
+int main() {
+    static char data[SIZE], out[4][100];
+    struct scull_io ios[5];
+    struct scull_batch b;
+    int fd, ret, i;
+
+    // 以只写方式打开会清空设备
+    fd = open(DEVICE, O_WRONLY);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    close(fd);
+    fd = open(DEVICE, O_RDWR);
+    SCULL_ASSERT(fd >= 0);
+    for (i = 0; i < SIZE; i++) data[i] = 'a' + i % 26;
+
+    // 一项写入可以跨越多个量子
+    memset(ios, 0, sizeof(ios));
+    ios[0].buf = (unsigned long)data;
+    ios[0].len = SIZE;
+    ios[0].flags = SCULL_IO_WRITE;
+    b.ios = (unsigned long)ios;
+    b.nr = 1;
+    b.pad = 0;
+    ret = ioctl(fd, SCULL_IOCBATCH, &b);
+    SCULL_ASSERT(ret == 1 && ios[0].result == SIZE);
+
+    // 乱序的读取，结果对应各自的项
+    memset(ios, 0, sizeof(ios));
+    for (i = 0; i < 4; i++) {
+        ios[i].off = (3 - i) * 5000 + 4050;
+        ios[i].buf = (unsigned long)out[i];
+        ios[i].len = sizeof(out[i]);
+    }
+    // 超出数据末尾的读取返回 0
+    ios[4].off = SIZE;
+    ios[4].buf = (unsigned long)out[0];
+    ios[4].len = 1;
+    b.nr = 5;
+    ret = ioctl(fd, SCULL_IOCBATCH, &b);
+    SCULL_ASSERT(ret == 5);
+    for (i = 0; i < 4; i++) {
+        SCULL_ASSERT(ios[i].result == sizeof(out[i]));
+        SCULL_ASSERT(memcmp(out[i], data + ios[i].off, sizeof(out[i])) == 0);
+    }
+    SCULL_ASSERT(ios[4].result == 0);
+
+    // 错误只影响出错的项
+    ios[0].flags = 0x80;
+    ret = ioctl(fd, SCULL_IOCBATCH, &b);
+    SCULL_ASSERT(ret == 5 && ios[0].result == -EINVAL &&
+                 ios[1].result == sizeof(out[1]));
+
+    // 保留的字段必须为 0
+    b.pad = 1;
+    ret = ioctl(fd, SCULL_IOCBATCH, &b);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+    b.pad = 0;
+
+    b.nr = SCULL_BATCH_MAX + 1;
+    ret = ioctl(fd, SCULL_IOCBATCH, &b);
+    SCULL_ASSERT(ret < 0 && errno == EINVAL);
+    close(fd);
+    return 0;
+}
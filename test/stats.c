@@ -0,0 +1,57 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define STATS_DIR "/sys/kernel/debug/scull/scull0/"
+
+// 从统计文件中取出指定计数器的值
+static long long get_stat(const char *name) {
+    FILE *f = fopen(STATS_DIR "stats", "r");
+    char key[64];
+    long long value;
+
+    if (!f) return -1;
+    while (fscanf(f, "%63s %lld", key, &value) == 2) {
+        if (strcmp(key, name) == 0) {
+            fclose(f);
+            return value;
+        }
+    }
+    fclose(f);
+    return -1;
+}
+
+int main() {
+    int fd, ret;
+    char buf[16];
+
+    // 没有挂载 debugfs 时跳过
+    fd = open(STATS_DIR "reset", O_WRONLY);
+    if (fd < 0) return 0;
+    ret = write(fd, "1", 1);
+    SCULL_ASSERT(ret == 1);
+    close(fd);
+    SCULL_ASSERT(get_stat("reads") == 0);
+    SCULL_ASSERT(get_stat("writes") == 0);
+
+    fd = open(DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    ret = write(fd, "hello", 5);
+    SCULL_ASSERT(ret == 5);
+    ret = pread(fd, buf, 5, 0);
+    SCULL_ASSERT(ret == 5);
+    close(fd);
+
+    SCULL_ASSERT(get_stat("writes") == 1);
+    SCULL_ASSERT(get_stat("write_bytes") == 5);
+    SCULL_ASSERT(get_stat("reads") == 1);
+    SCULL_ASSERT(get_stat("read_bytes") == 5);
+    return 0;
+}
@@ -41,8 +41,103 @@ void ScullAssert(const char* file, int line, bool test, const char* expr) {
 #define SCULL_IOCHQSET _IO(SCULL_IOC_MAGIC, 12)
 #define SCULL_P_IOCTSIZE _IO(SCULL_IOC_MAGIC, 13)
 #define SCULL_P_IOCQSIZE _IO(SCULL_IOC_MAGIC, 14)
+#define SCULL_P_IOCTRCVLOWAT _IO(SCULL_IOC_MAGIC, 15)
+#define SCULL_P_IOCQRCVLOWAT _IO(SCULL_IOC_MAGIC, 16)
+#define SCULL_P_IOCTSNDLOWAT _IO(SCULL_IOC_MAGIC, 17)
+#define SCULL_P_IOCQSNDLOWAT _IO(SCULL_IOC_MAGIC, 18)
 
-#define SCULL_IOC_MAXNR 14
+struct scull_p_batch {
+    int vmin;
+    int vtime;
+};
+
+#define SCULL_P_IOCSBATCH _IOW(SCULL_IOC_MAGIC, 19, struct scull_p_batch)
+#define SCULL_P_IOCGBATCH _IOR(SCULL_IOC_MAGIC, 20, struct scull_p_batch)
+#define SCULL_P_IOCTBUSYPOLL _IO(SCULL_IOC_MAGIC, 21)
+#define SCULL_P_IOCQBUSYPOLL _IO(SCULL_IOC_MAGIC, 22)
+
+#define SCULL_P_BROADCAST 0x1
+#define SCULL_P_LAP 0x2
+#define SCULL_P_OVERWRITE 0x4
+#define SCULL_P_RECORDS 0x8
+
+#define SCULL_P_IOCTMODE _IO(SCULL_IOC_MAGIC, 23)
+#define SCULL_P_IOCQMODE _IO(SCULL_IOC_MAGIC, 24)
+#define SCULL_P_IOCGDROPPED _IOR(SCULL_IOC_MAGIC, 25, unsigned long long)
+
+struct scull_p_eventfd {
+    int rfd;
+    int wfd;
+};
+
+#define SCULL_P_IOCSEVENTFD _IOW(SCULL_IOC_MAGIC, 26, struct scull_p_eventfd)
+
+#define SCULL_IOCTCOMPRESS _IO(SCULL_IOC_MAGIC, 27)
+#define SCULL_IOCQCOMPRESS _IO(SCULL_IOC_MAGIC, 28)
+
+#define SCULL_IOCTDEDUP _IO(SCULL_IOC_MAGIC, 29)
+#define SCULL_IOCQDEDUP _IO(SCULL_IOC_MAGIC, 30)
+
+#define SCULL_IOCTLIMIT _IO(SCULL_IOC_MAGIC, 31)
+#define SCULL_IOCQLIMIT _IO(SCULL_IOC_MAGIC, 32)
+
+#define SCULL_IOCTBACKING _IO(SCULL_IOC_MAGIC, 33)
+#define SCULL_IOCFLUSH _IO(SCULL_IOC_MAGIC, 34)
+
+struct scull_copy {
+    int src_fd;
+    unsigned int flags;
+    unsigned long long src_off;
+    unsigned long long dst_off;
+    unsigned long long len;
+};
+
+#define SCULL_COPY_REMAP 0x1
+#define SCULL_IOCCOPY _IOW(SCULL_IOC_MAGIC, 35, struct scull_copy)
+
+struct scull_io {
+    unsigned long long off;
+    unsigned long long buf;
+    unsigned int len;
+    unsigned int flags;
+    long long result;
+};
+
+#define SCULL_IO_WRITE 0x1
+
+struct scull_batch {
+    unsigned long long ios;
+    unsigned int nr;
+    unsigned int pad;
+};
+
+#define SCULL_BATCH_MAX 1024
+#define SCULL_IOCBATCH _IOW(SCULL_IOC_MAGIC, 36, struct scull_batch)
+
+struct scull_kv {
+    unsigned long long key;
+    unsigned long long val;
+    unsigned int klen;
+    unsigned int vlen;
+};
+
+#define SCULL_KV_KEY_MAX 256
+#define SCULL_KV_VAL_MAX (1 << 20)
+#define SCULL_IOCKVPUT _IOW(SCULL_IOC_MAGIC, 37, struct scull_kv)
+#define SCULL_IOCKVGET _IOWR(SCULL_IOC_MAGIC, 38, struct scull_kv)
+#define SCULL_IOCKVDEL _IOW(SCULL_IOC_MAGIC, 39, struct scull_kv)
+
+struct scull_cache {
+    unsigned int flags;
+    unsigned int ttl_ms;
+    unsigned long long budget;
+};
+
+#define SCULL_CACHE_ON 0x1
+#define SCULL_IOCSCACHE _IOW(SCULL_IOC_MAGIC, 40, struct scull_cache)
+#define SCULL_IOCGCACHE _IOR(SCULL_IOC_MAGIC, 41, struct scull_cache)
+
+#define SCULL_IOC_MAXNR 41
 
 #ifndef SCULL_P_BUFFER
 #define SCULL_P_BUFFER 4096
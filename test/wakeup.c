@@ -0,0 +1,139 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define NR_READERS 4
+#define SNDLOWAT 2048
+
+// 判断一个线程是否被唤醒过：被唤醒的线程发现条件不满足后重新睡眠，
+// 自愿上下文切换的次数会增加，只要没有被唤醒，这个次数就不变
+
+int fd;
+
+struct reader {
+    pthread_t thr;
+    pid_t tid;
+    volatile int done;
+    char c;
+};
+
+struct reader readers[NR_READERS];
+volatile pid_t poller_tid;
+short poll_revents;
+
+static long switches(pid_t tid) {
+    char path[64], line[128];
+    long n = -1;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", tid);
+    f = fopen(path, "r");
+    SCULL_ASSERT(f);
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "voluntary_ctxt_switches: %ld", &n) == 1) break;
+    fclose(f);
+    SCULL_ASSERT(n >= 0);
+    return n;
+}
+
+void *reader_thread(void *arg) {
+    struct reader *r = arg;
+
+    r->tid = syscall(SYS_gettid);
+    SCULL_ASSERT(read(fd, &r->c, 1) == 1);
+    r->done = 1;
+    return NULL;
+}
+
+void *poller_thread(void *arg) {
+    struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+
+    poller_tid = syscall(SYS_gettid);
+    SCULL_ASSERT(poll(&pfd, 1, TIMEOUT_SECONDS * 1000) == 1);
+    poll_revents = pfd.revents;
+    return NULL;
+}
+
+void signal_handler(int sig) {
+    printf("Wakeup Timed out.\n");
+    exit(1);
+}
+
+int main() {
+    long before[NR_READERS], poll_before;
+    char buf[SCULL_P_BUFFER], seen[NR_READERS + 1] = {0};
+    pthread_t poller;
+    int nfd, ret, i, n;
+
+    signal(SIGALRM, signal_handler);
+    alarm(TIMEOUT_SECONDS);
+
+    fd = open(PIPE_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device");
+        return errno;
+    }
+    nfd = open(PIPE_DEVICE, O_RDWR | O_NONBLOCK);
+    SCULL_ASSERT(nfd >= 0);
+
+    // 几个读者阻塞在空管道上
+    for (i = 0; i < NR_READERS; i++)
+        pthread_create(&readers[i].thr, NULL, reader_thread, readers + i);
+    usleep(200 * 1000);
+    for (i = 0; i < NR_READERS; i++) before[i] = switches(readers[i].tid);
+
+    // 一次写入只唤醒一个读者，其余读者不会被叫醒
+    ret = write(nfd, "a", 1);
+    SCULL_ASSERT(ret == 1);
+    usleep(200 * 1000);
+    for (i = 0, n = 0; i < NR_READERS; i++) {
+        if (readers[i].done) {
+            n++;
+            continue;
+        }
+        SCULL_ASSERT(switches(readers[i].tid) == before[i]);
+    }
+    SCULL_ASSERT(n == 1);
+
+    // 数据足够时唤醒沿读者传递，剩下的读者各读到一个字节
+    ret = write(nfd, "bcd", 3);
+    SCULL_ASSERT(ret == 3);
+    for (i = 0; i < NR_READERS; i++) {
+        pthread_join(readers[i].thr, NULL);
+        seen[readers[i].c - 'a'] = 1;
+    }
+    SCULL_ASSERT(!memcmp(seen, "\1\1\1\1", NR_READERS));
+
+    // 剩余空间低于写低水位时只等待 POLLOUT 的 poll 不会被写入唤醒
+    ret = ioctl(fd, SCULL_P_IOCTSNDLOWAT, SNDLOWAT);
+    SCULL_ASSERT(ret == 0);
+    ret = write(nfd, buf, SCULL_P_BUFFER - 100);
+    SCULL_ASSERT(ret == SCULL_P_BUFFER - 100);
+    pthread_create(&poller, NULL, poller_thread, NULL);
+    usleep(200 * 1000);
+    poll_before = switches(poller_tid);
+    ret = write(nfd, buf, 10);
+    SCULL_ASSERT(ret == 10);
+    usleep(200 * 1000);
+    SCULL_ASSERT(switches(poller_tid) == poll_before);
+
+    // 读走数据后剩余空间达到写低水位，poll 返回 POLLOUT
+    while (read(nfd, buf, sizeof(buf)) > 0)
+        ;
+    pthread_join(poller, NULL);
+    SCULL_ASSERT(poll_revents & POLLOUT);
+
+    ret = ioctl(fd, SCULL_P_IOCTSNDLOWAT, 1);
+    SCULL_ASSERT(ret == 0);
+    close(nfd);
+    close(fd);
+    return 0;
+}